@@ -0,0 +1,285 @@
+#ifndef RGM_BINARY_H
+#define RGM_BINARY_H
+
+#include <RcppArmadillo.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Files are memory-mapped where POSIX mmap is available and read with seek and read otherwise
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RGM_MMAP
+#endif
+
+
+// Binary file of individual level data
+// The file starts with a header of 40 bytes: the magic bytes "RGMBIN1" followed by a zero byte, then n, p, k and
+// the type code as little endian 64 bit unsigned integers. The type code is 0 for 64 bit doubles, 1 for 32 bit
+// floats and 2 for 8 bit signed integers such as genotype dosages. The header is followed by Y (n * p) and then
+// X (n * k), both in column major order with entries of the given type in little endian byte order
+class Binary_File {
+
+public:
+
+  // Number of rows, number of columns of Y and X, type code and size of an entry in bytes
+  uint64_t n, p, k, Type, Entry_Size;
+
+  // Size of the header in bytes
+  static const uint64_t Header_Size = 40;
+
+  // Open the file, read and check its header
+  explicit Binary_File(const std::string& Path) : n(0), p(0), k(0), Type(0), Entry_Size(0), Size(0) {
+
+#ifdef RGM_MMAP
+    // Map the whole file
+    Descriptor = open(Path.c_str(), O_RDONLY);
+
+    if (Descriptor < 0) {
+
+      Rcpp::stop("Unable to open " + Path + ".");
+
+    }
+
+    struct stat Info;
+    fstat(Descriptor, &Info);
+    Size = Info.st_size;
+
+    Data = nullptr;
+
+    if (Size > 0) {
+
+      void* Map = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, Descriptor, 0);
+
+      if (Map == MAP_FAILED) {
+
+        close(Descriptor);
+        Rcpp::stop("Unable to map " + Path + " into memory.");
+
+      }
+
+      Data = static_cast<const unsigned char*>(Map);
+
+    }
+#else
+    // Open the file for reading
+    Stream.open(Path.c_str(), std::ios::binary);
+
+    if (!Stream) {
+
+      Rcpp::stop("Unable to open " + Path + ".");
+
+    }
+
+    Stream.seekg(0, std::ios::end);
+    Size = Stream.tellg();
+#endif
+
+    // Read header
+    unsigned char Header[Header_Size];
+
+    if (Size < Header_Size) {
+
+      Close();
+      Rcpp::stop(Path + " is too short to be an RGM binary file.");
+
+    }
+
+    Read(0, Header_Size, Header);
+
+    if (std::memcmp(Header, "RGMBIN1", 8) != 0) {
+
+      Close();
+      Rcpp::stop(Path + " is not an RGM binary file.");
+
+    }
+
+    n = Little_Endian(Header + 8);
+    p = Little_Endian(Header + 16);
+    k = Little_Endian(Header + 24);
+    Type = Little_Endian(Header + 32);
+
+    // Check type and size
+    if (Type > 2) {
+
+      Close();
+      Rcpp::stop("Unknown type code in the header of " + Path + ".");
+
+    }
+
+    Entry_Size = (Type == 0) ? 8 : (Type == 1) ? 4 : 1;
+
+    // Check that the body holds n * (p + k) entries, bounding the dimensions by division first so that a corrupt
+    // header can not overflow the product
+    uint64_t Body = Size - Header_Size;
+
+    if (n == 0 || p > Body || k > Body - p || p + k == 0 || n > Body / Entry_Size / (p + k) || n * (p + k) * Entry_Size != Body) {
+
+      Close();
+      Rcpp::stop("Size of " + Path + " does not match the dimensions in its header.");
+
+    }
+
+  }
+
+  // Unmap and close the file
+  ~Binary_File() {
+
+    Close();
+
+  }
+
+  // Read rows Row to Row + nRow - 1 of columns Col to Col + nCol - 1 of [Y X] into Out as doubles
+  void Read_Rows(uint64_t Col, uint64_t nCol, uint64_t Row, uint64_t nRow, arma::mat& Out) {
+
+    Out.set_size(nRow, nCol);
+    Bytes.resize(nRow * Entry_Size);
+
+    for (uint64_t j = 0; j < nCol; j++) {
+
+      // The rows of a column are contiguous
+      Read(Header_Size + ((Col + j) * n + Row) * Entry_Size, nRow * Entry_Size, Bytes.data());
+
+      double* Column = Out.colptr(j);
+
+      // Convert entries to doubles, decoding the little endian bytes so the result does not depend on the byte order
+      // of the machine
+      if (Type == 0) {
+
+        for (uint64_t i = 0; i < nRow; i++) {
+
+          uint64_t Bits = Little_Endian(&Bytes[8 * i], 8);
+          std::memcpy(&Column[i], &Bits, 8);
+
+        }
+
+      } else if (Type == 1) {
+
+        for (uint64_t i = 0; i < nRow; i++) {
+
+          uint32_t Bits = Little_Endian(&Bytes[4 * i], 4);
+          float x;
+          std::memcpy(&x, &Bits, 4);
+          Column[i] = x;
+
+        }
+
+      } else {
+
+        for (uint64_t i = 0; i < nRow; i++) {
+
+          Column[i] = static_cast<signed char>(Bytes[i]);
+
+        }
+
+      }
+
+    }
+
+  }
+
+  // Calculate 64 bit FNV-1a hash of the whole file
+  uint64_t Hash() {
+
+    uint64_t h = 14695981039346656037ULL;
+    std::vector<unsigned char> Block(1 << 20);
+
+    for (uint64_t Offset = 0; Offset < Size; Offset += Block.size()) {
+
+      uint64_t Length = std::min<uint64_t>(Block.size(), Size - Offset);
+      Read(Offset, Length, Block.data());
+
+      for (uint64_t b = 0; b < Length; b++) {
+
+        h = (h ^ Block[b]) * 1099511628211ULL;
+
+      }
+
+    }
+
+    return h;
+
+  }
+
+private:
+
+  // Size of the file in bytes and buffer for the bytes of a column
+  uint64_t Size;
+  std::vector<unsigned char> Bytes;
+
+#ifdef RGM_MMAP
+  int Descriptor;
+  const unsigned char* Data;
+#else
+  std::ifstream Stream;
+#endif
+
+  // Copy Length bytes starting at Offset into Out
+  void Read(uint64_t Offset, uint64_t Length, unsigned char* Out) {
+
+#ifdef RGM_MMAP
+    std::memcpy(Out, Data + Offset, Length);
+#else
+    Stream.seekg(Offset);
+    Stream.read(reinterpret_cast<char*>(Out), Length);
+#endif
+
+  }
+
+  // Unmap and close the file, safe to call more than once
+  void Close() {
+
+#ifdef RGM_MMAP
+    if (Data != nullptr) {
+
+      munmap(const_cast<unsigned char*>(Data), Size);
+      Data = nullptr;
+
+    }
+
+    if (Descriptor >= 0) {
+
+      close(Descriptor);
+      Descriptor = -1;
+
+    }
+#else
+    if (Stream.is_open()) {
+
+      Stream.close();
+
+    }
+#endif
+
+  }
+
+  // Decode a little endian unsigned integer of nByte bytes
+  static uint64_t Little_Endian(const unsigned char* x, int nByte = 8) {
+
+    uint64_t Value = 0;
+
+    for (int b = 0; b < nByte; b++) {
+
+      Value |= (uint64_t) x[b] << (8 * b);
+
+    }
+
+    return Value;
+
+  }
+
+  // The file can not be copied
+  Binary_File(const Binary_File&);
+  Binary_File& operator=(const Binary_File&);
+
+};
+
+
+#endif
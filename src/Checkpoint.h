@@ -0,0 +1,201 @@
+#ifndef RGM_CHECKPOINT_H
+#define RGM_CHECKPOINT_H
+
+#include <RcppArmadillo.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+
+// Binary checkpoint file of the sampler
+// The file starts with the magic bytes "RGMCKP1" followed by a zero byte. Every value after that is stored in the
+// order of the Serialize functions of the sampler, in the native byte order of the machine, so a checkpoint is
+// meant to be resumed on the machine that wrote it or one of the same kind. Saving and restoring run the same
+// Serialize functions, one archive writes what they pass and the other overwrites it, so the two can not drift
+// apart. A checkpoint is written to Path + ".tmp" and renamed to Path when it is complete, so a run killed while
+// writing leaves the previous checkpoint intact
+class Checkpoint_Archive {
+
+public:
+
+  // Whether the archive restores values from the file
+  bool Reading;
+
+  // Open Path for restoring, or its temporary file for saving
+  Checkpoint_Archive(const std::string& Path, bool Reading) : Reading(Reading), Path(Path) {
+
+    char Magic[8] = {'R', 'G', 'M', 'C', 'K', 'P', '1', '\0'};
+
+    if (Reading) {
+
+      Stream.open(Path.c_str(), std::ios::in | std::ios::binary);
+
+      if (!Stream) {
+
+        Rcpp::stop("Unable to open " + Path + ".");
+
+      }
+
+      // Check magic bytes
+      char Header[8];
+      Stream.read(Header, 8);
+
+      if (!Stream || std::memcmp(Header, Magic, 8) != 0) {
+
+        Rcpp::stop(Path + " is not an RGM checkpoint file.");
+
+      }
+
+    } else {
+
+      Stream.open((Path + ".tmp").c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+      if (!Stream) {
+
+        Rcpp::stop("Unable to write " + Path + ".tmp.");
+
+      }
+
+      Stream.write(Magic, 8);
+
+    }
+
+  }
+
+  // Save or restore n raw bytes
+  void Bytes(void* x, size_t n) {
+
+    if (Reading) {
+
+      Stream.read(static_cast<char*>(x), n);
+
+      if (!Stream) {
+
+        Rcpp::stop(Path + " ends before the end of the checkpoint.");
+
+      }
+
+    } else {
+
+      Stream.write(static_cast<const char*>(x), n);
+
+    }
+
+  }
+
+  // Save or restore a number
+  template <typename T>
+  void Value(T& x) {
+
+    static_assert(std::is_arithmetic<T>::value, "Value only handles numbers");
+
+    Bytes(&x, sizeof(T));
+
+  }
+
+  // Save or restore a matrix or vector with its dimensions
+  template <typename Mat_Type>
+  void Matrix(Mat_Type& x) {
+
+    typedef typename Mat_Type::elem_type T;
+
+    uint64_t n_rows = x.n_rows, n_cols = x.n_cols;
+
+    Value(n_rows);
+    Value(n_cols);
+
+    if (Reading) {
+
+      x.set_size(n_rows, n_cols);
+
+    }
+
+    Bytes(x.memptr(), x.n_elem * sizeof(T));
+
+  }
+
+  // Save or restore a vector of numbers with its length
+  template <typename T>
+  void Vector(std::vector<T>& x) {
+
+    static_assert(std::is_arithmetic<T>::value, "Vector only handles numbers");
+
+    uint64_t n = x.size();
+
+    Value(n);
+
+    if (Reading) {
+
+      x.resize(n);
+
+    }
+
+    Bytes(x.data(), n * sizeof(T));
+
+  }
+
+  // Save or restore a string with its length
+  void String(std::string& x) {
+
+    uint64_t n = x.size();
+
+    Value(n);
+
+    if (Reading) {
+
+      x.resize(n);
+
+    }
+
+    Bytes(&x[0], n);
+
+  }
+
+  // Save or restore a vector of strings with its length
+  void Strings(std::vector<std::string>& x) {
+
+    uint64_t n = x.size();
+
+    Value(n);
+
+    if (Reading) {
+
+      x.resize(n);
+
+    }
+
+    for (uint64_t l = 0; l < n; l++) {
+
+      String(x[l]);
+
+    }
+
+  }
+
+  // Finish saving and replace the previous checkpoint
+  void Commit() {
+
+    Stream.close();
+
+    if (!Stream || std::rename((Path + ".tmp").c_str(), Path.c_str()) != 0) {
+
+      Rcpp::stop("Unable to write " + Path + ".");
+
+    }
+
+  }
+
+private:
+
+  // Path of the checkpoint and its stream
+  std::string Path;
+  std::fstream Stream;
+
+};
+
+
+#endif
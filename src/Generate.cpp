@@ -1,14 +1,26 @@
 #include <RcppArmadillo.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "RNG.h"
+#include "Packed.h"
+#include "Gram.h"
+#include "Binary.h"
+#include "Checkpoint.h"
+#include "Sparse_LU.h"
 // [[Rcpp::depends(RcppArmadillo)]]
+// [[Rcpp::plugins(openmp)]]
 using namespace Rcpp;
 
 
 // Sample Rho
-// [[Rcpp::export]]
-double Sample_Rho(double Gamma, double a_rho, double b_rho) {
+double Sample_Rho(RGM_RNG& RNG, double Gamma, double a_rho, double b_rho) {
 
   // Sample Rho from beta distribution
-  double Rho = Rcpp::rbeta(1, Gamma + a_rho, 1 - Gamma + b_rho)(0);
+  double Rho = RNG.Beta(Gamma + a_rho, 1 - Gamma + b_rho);
 
   // Return Rho
   return Rho;
@@ -17,11 +29,10 @@ double Sample_Rho(double Gamma, double a_rho, double b_rho) {
 
 
 // Sample Psi
-// [[Rcpp::export]]
-double Sample_Psi(double Phi, double a_psi, double b_psi) {
+double Sample_Psi(RGM_RNG& RNG, double Phi, double a_psi, double b_psi) {
 
   // Sample Psi from beta distribution
-  double Psi = Rcpp::rbeta(1, Phi + a_psi, 1 - Phi + b_psi)(0);
+  double Psi = RNG.Beta(Phi + a_psi, 1 - Phi + b_psi);
 
   // Return Psi
   return Psi;
@@ -32,11 +43,10 @@ double Sample_Psi(double Phi, double a_psi, double b_psi) {
 
 
 // Sample Tau
-// [[Rcpp::export]]
-double Sample_Tau(double a, double gamma, double tau, double nu_1) {
+double Sample_Tau(RGM_RNG& RNG, double a, double gamma, double tau, double nu_1) {
 
   // Sample Epsilon based on old tau
-  double Epsilon = 1 / Rcpp::rgamma(1, 1, 1 / (1 + 1 / tau))(0);
+  double Epsilon = 1 / RNG.Gamma(1, 1 / (1 + 1 / tau));
 
   // Initialize Tau
   double Tau;
@@ -45,12 +55,12 @@ double Sample_Tau(double a, double gamma, double tau, double nu_1) {
   if (gamma == 1) {
 
     // Sample Tau based on a and Epsilon
-    Tau = 1 / Rcpp::rgamma(1, 1, 1 / (a * a / 2 + 1 / Epsilon))(0);
+    Tau = 1 / RNG.Gamma(1, 1 / (a * a / 2 + 1 / Epsilon));
 
   } else {
 
     // Sample Tau based on a, nu_1 and Epsilon
-    Tau = 1 / Rcpp::rgamma(1, 1, 1 / (a * a / (2 * nu_1) + 1 / Epsilon))(0);
+    Tau = 1 / RNG.Gamma(1, 1 / (a * a / (2 * nu_1) + 1 / Epsilon));
 
   }
 
@@ -62,11 +72,10 @@ double Sample_Tau(double a, double gamma, double tau, double nu_1) {
 
 
 // Sample Eta
-// [[Rcpp::export]]
-double Sample_Eta(double b, double phi, double eta, double nu_2) {
+double Sample_Eta(RGM_RNG& RNG, double b, double phi, double eta, double nu_2) {
 
   // Sample Epsilon based on old eta
-  double Epsilon = 1 / Rcpp::rgamma(1, 1, 1 / (1 + 1 / eta))(0);
+  double Epsilon = 1 / RNG.Gamma(1, 1 / (1 + 1 / eta));
 
   // Initialize Eta
   double Eta;
@@ -75,12 +84,12 @@ double Sample_Eta(double b, double phi, double eta, double nu_2) {
   if (phi == 1) {
 
     // Sample Eta based on b and Epsilon
-    Eta = 1 / Rcpp::rgamma(1, 1, 1 / (b * b / 2 + 1 / Epsilon))(0);
+    Eta = 1 / RNG.Gamma(1, 1 / (b * b / 2 + 1 / Epsilon));
 
   } else {
 
     // Sample Eta based on b, nu_2 and Epsilon
-    Eta = 1 / Rcpp::rgamma(1, 1, 1 / (b * b / (2 * nu_2) + 1 / Epsilon))(0);
+    Eta = 1 / RNG.Gamma(1, 1 / (b * b / (2 * nu_2) + 1 / Epsilon));
 
   }
 
@@ -92,14 +101,13 @@ double Sample_Eta(double b, double phi, double eta, double nu_2) {
 
 
 // Sample Gamma
-// [[Rcpp::export]]
-double Sample_Gamma(double a, double tau, double rho, double nu_1) {
+double Sample_Gamma(RGM_RNG& RNG, double a, double tau, double rho, double nu_1) {
 
   // Calculate acceptance probability
   double p = exp(-0.5 * (a * a / tau)) * rho / (exp(-0.5 * (a * a / tau)) * rho + 1 / sqrt(nu_1) * exp(-0.5 * (a * a / (nu_1 * tau))) * (1 - rho));
 
   // Sample Gamma from binomial distribution
-  double Gamma = Rcpp::rbinom(1, 1, p)(0);
+  double Gamma = RNG.Bernoulli(p);
 
   // Return Gamma
   return Gamma;
@@ -109,14 +117,13 @@ double Sample_Gamma(double a, double tau, double rho, double nu_1) {
 
 
 // Sample Phi
-// [[Rcpp::export]]
-double Sample_Phi(double b, double eta, double psi, double nu_2) {
+double Sample_Phi(RGM_RNG& RNG, double b, double eta, double psi, double nu_2) {
 
   // Calculate acceptance probability
   double p = exp(-0.5 * (b * b / eta)) * psi / (exp(-0.5 * (b * b / eta)) * psi + 1 / sqrt(nu_2) * exp(-0.5 * (b * b / (nu_2 * eta))) * (1 - psi));
 
   // Sample Phi from binomial distribution
-  double Phi = Rcpp::rbinom(1, 1, p)(0);
+  double Phi = RNG.Bernoulli(p);
 
   // Return Phi
   return Phi;
@@ -125,11 +132,10 @@ double Sample_Phi(double b, double eta, double psi, double nu_2) {
 
 
 // Sample Sigma
-// [[Rcpp::export]]
-double Sample_Sigma(double n, double z_sum, double a_sigma, double b_sigma) {
+double Sample_Sigma(RGM_RNG& RNG, double n, double z_sum, double a_sigma, double b_sigma) {
 
   // Sample Sigma from inverse gamma distribution
-  double Sigma = 1.0 / Rcpp::rgamma(1, n / 2.0 + a_sigma, 1.0 / (z_sum / 2.0 + b_sigma))(0);
+  double Sigma = 1.0 / RNG.Gamma(n / 2.0 + a_sigma, 1.0 / (z_sum / 2.0 + b_sigma));
 
   // Return Sigma
   return Sigma;
@@ -137,84 +143,106 @@ double Sample_Sigma(double n, double z_sum, double a_sigma, double b_sigma) {
 }
 
 
-// Calculate target value for a particular A for the model when both X and Y are there
-// [[Rcpp::export]]
-double Target_A(double a, double N, double gamma, double tau, double nu_1, double Trace3, double Trace4, double Trace5, double Trace6, double logdet) {
+// Sample Tau or Eta for all the entries of a matrix at once, entries with Mask equal to 0 are kept
+// Both draws of Sample_Tau have shape 1, so they are exponential and are drawn by inversion from a buffer of
+// uniforms. This leaves a loop without branches over contiguous arrays that the compiler can vectorize
+void Sample_Scale_Batch(RGM_RNG& RNG, const arma::mat& x, const arma::mat& z, arma::mat& Scale, const arma::mat& Mask, double nu) {
 
-  // Calculate Sum term inside exponential in likelihood
-  double Sum = Trace3 + Trace4 + Trace5 + Trace6;
+  // Draw two uniforms for every entry
+  arma::uword n = Scale.n_elem;
+  std::vector<double> U(2 * n);
 
-  // Calculate Target value
-  double Target = N * logdet - Sum / 2 - gamma * (a * a / (2 * tau)) - (1 - gamma) * (0.5 * log(nu_1) + a * a / (2 * nu_1 * tau));
+  RNG.Fill_Uniform(U.data(), 2 * n);
 
-  // Return Target
-  return Target;
+  // Read pointers
+  const double* x_Mem = x.memptr();
+  const double* z_Mem = z.memptr();
+  const double* Mask_Mem = Mask.memptr();
+  double* Scale_Mem = Scale.memptr();
+
+#pragma omp simd
+  for (arma::uword l = 0; l < n; l++) {
+
+    // Sample 1 / Epsilon from exponential with rate 1 + 1 / Scale based on old Scale
+    double Inv_Epsilon = -std::log(U[l]) / (1 + 1 / Scale_Mem[l]);
+
+    // Sample Scale from inverse exponential based on x, z, nu and Epsilon
+    double Rate = x_Mem[l] * x_Mem[l] / (2 * (z_Mem[l] == 1 ? 1 : nu)) + Inv_Epsilon;
+    double New = Rate / -std::log(U[n + l]);
+
+    Scale_Mem[l] = (Mask_Mem[l] != 0) ? New : Scale_Mem[l];
+
+  }
 
 }
 
 
-// Sample a particular entry of matrix A for the model when both X and Y are there
-// [[Rcpp::export]]
-Rcpp::List Sample_A(const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& A, const arma::mat& A_Pseudo, double i, double j, const arma::colvec& Sigma_Inv, double N, double p, const arma::mat& B, double gamma, double tau, double nu_1, double prop_var1, double tA, double Trace3, double Trace4, double Trace5, double Trace6, arma::mat InvMat, double logdet) {
+// Sample Rho or Psi for all the entries of a matrix at once, entries with Mask equal to 0 are kept
+// Beta draws need rejection sampling, so they are drawn entry by entry without vectorization
+void Sample_Probability_Batch(RGM_RNG& RNG, const arma::mat& z, arma::mat& Prob, const arma::mat& Mask, double a, double b) {
 
-  // Value to update
-  double a = A_Pseudo(i, j);
+  for (arma::uword l = 0; l < Prob.n_elem; l++) {
 
-  // Proposed value
-  double a_new = Rcpp::rnorm(1, a, sqrt(prop_var1))(0);
+    if (Mask(l) != 0) {
 
-  // Create a copy of matrix A
-  arma::mat A_new = A;
+      // Sample Prob from beta distribution
+      Prob(l) = RNG.Beta(z(l) + a, 1 - z(l) + b);
 
-  // Modify the copy with the proposed a value
-  A_new(i, j) = (fabs(a_new) > tA) * a_new;
+    }
 
-  // Modify logdet
-  double logdet_new = logdet + log(fabs(1 + ((fabs(a) > tA) * a - (fabs(a_new) > tA) * a_new) * InvMat(j, i)));
+  }
 
+}
 
-  // Calculate new trace values
-  double Trace3_New = Trace3 - N * ((fabs(a_new) > tA) * a_new - (fabs(a) > tA) * a) * Sigma_Inv(i) * S_YY(i, j);
-  double Trace4_New = Trace4 - N * ((fabs(a_new) > tA) * a_new - (fabs(a) > tA) * a) * Sigma_Inv(i) * S_YY(i, j);
-  double Trace5_New = Trace5 + N * ((fabs(a_new) > tA) * a_new - (fabs(a) > tA) * a) * Sigma_Inv(i) * arma::trace(A.row(i) * S_YY.col(j) + S_YY.row(j) * A_new.row(i).t());
-  double Trace6_New = Trace6 + 2 * N * ((fabs(a_new) > tA) * a_new - (fabs(a) > tA) * a) * Sigma_Inv(i) * arma::trace(B.row(i) * S_YX.row(j).t());
 
-  // Calculate target values with a and a_new
-  double Target1 = Target_A(a_new, N, gamma, tau, nu_1, Trace3_New, Trace4_New, Trace5_New, Trace6_New, logdet_new);
-  double Target2 = Target_A(a, N, gamma, tau, nu_1, Trace3, Trace4, Trace5, Trace6, logdet);
+// Sample Gamma or Phi for all the entries of a matrix at once, entries with Mask equal to 0 are kept
+void Sample_Indicator_Batch(RGM_RNG& RNG, const arma::mat& x, const arma::mat& Scale, const arma::mat& Prob, arma::mat& z, const arma::mat& Mask, double nu) {
 
-  // Calculate r i.e. the differnce between two target values
-  double r = Target1 - Target2;
+  // Draw a uniform for every entry
+  arma::uword n = z.n_elem;
+  std::vector<double> U(n);
 
-  // Sample u from Uniform(0, 1)
-  double u = Rcpp::runif(1, 0, 1)(0);
+  RNG.Fill_Uniform(U.data(), n);
 
-  // Compare u and r
-  if (r >= log(u)) {
+  // Read pointers
+  const double* x_Mem = x.memptr();
+  const double* Scale_Mem = Scale.memptr();
+  const double* Prob_Mem = Prob.memptr();
+  const double* Mask_Mem = Mask.memptr();
+  double* z_Mem = z.memptr();
 
-    // Update a, trace values, logdet and InvMat
-    a = a_new;
+#pragma omp simd
+  for (arma::uword l = 0; l < n; l++) {
 
-    Trace3 = Trace3_New;
-    Trace4 = Trace4_New;
-    Trace5 = Trace5_New;
-    Trace6 = Trace6_New;
+    // Calculate acceptance probability
+    double Slab = std::exp(-0.5 * (x_Mem[l] * x_Mem[l] / Scale_Mem[l])) * Prob_Mem[l];
+    double Spike = 1 / std::sqrt(nu) * std::exp(-0.5 * (x_Mem[l] * x_Mem[l] / (nu * Scale_Mem[l]))) * (1 - Prob_Mem[l]);
 
-    logdet = logdet_new;
+    // Sample z from binomial distribution
+    double New = (U[l] < Slab / (Slab + Spike)) * 1.0;
 
-    InvMat = InvMat - (((fabs(a) > tA) * a - (fabs(a_new) > tA) * a_new) / (1 + ((fabs(a) > tA) * a - (fabs(a_new) > tA) * a_new) * InvMat(j, i))) * (InvMat.col(i) * InvMat.row(j));
+    z_Mem[l] = (Mask_Mem[l] != 0) ? New : z_Mem[l];
 
   }
 
-  // Return a, trace values, logdet and InvMat
-  return Rcpp::List::create(Rcpp::Named("a") = a, Rcpp::Named("Trace3") = Trace3,
-                            Rcpp::Named("Trace4") = Trace4, Rcpp::Named("Trace5") = Trace5,
-                            Rcpp::Named("Trace6") = Trace6, Rcpp::Named("logdet") = logdet,
-                            Rcpp::Named("InvMat") = InvMat);
-
 }
 
 
+// Calculate target value for a particular A for the model when both X and Y are there
+// [[Rcpp::export]]
+double Target_A(double a, double N, double gamma, double tau, double nu_1, double Trace3, double Trace4, double Trace5, double Trace6, double logdet) {
+
+  // Calculate Sum term inside exponential in likelihood
+  double Sum = Trace3 + Trace4 + Trace5 + Trace6;
+
+  // Calculate Target value
+  double Target = N * logdet - Sum / 2 - gamma * (a * a / (2 * tau)) - (1 - gamma) * (0.5 * log(nu_1) + a * a / (2 * nu_1 * tau));
+
+  // Return Target
+  return Target;
+
+}
+
 
 // Calculate target value for a particular B
 // [[Rcpp::export]]
@@ -232,425 +260,420 @@ double Target_B(double b, double phi, double eta, double nu_2, double Trace1, do
 }
 
 
-// Sample a particular entry of matrix B
-// [[Rcpp::export]]
-Rcpp::List Sample_B(const arma::mat& S_YX, const arma::mat& S_XX, const arma::mat& B, const arma::mat& B_Pseudo, double i, double j, const arma::colvec& Sigma_Inv, const arma::mat& MultMat, double N, double phi, double eta, double nu_2, double prop_var2, double tB, double Trace1, double Trace2) {
-
-  // Value to update
-  double b = B_Pseudo(i, j);
-
-  // Proposed value
-  double b_new = Rcpp::rnorm(1, b, sqrt(prop_var2))(0);
-
-  // Create a copy of matrix B
-  arma::mat B_new = B;
-
-  // Modify the copy with the proposed b value
-  B_new(i, j) = (fabs(b_new) > tB) * b_new;
+// Robbins-Monro update of the log proposal sd of an entry toward the target acceptance rate
+// With steps decreasing to 0 the proposal converges, and it is frozen after burn-in so the retained chain is a
+// Markov chain with a fixed kernel
+inline void Adapt_Log_Sd(double& Log_Sd, bool Accepted, double Target, double Step) {
 
-  // Calculate new trace values
-  double Trace1_New = Trace1 - 2 * N * arma::trace(Sigma_Inv(i) * ((fabs(b_new) > tB) * b_new - (fabs(b) > tB) * b) * (MultMat.row(i) * S_YX.col(j)));
-  double Trace2_New = Trace2 + N * arma::trace(Sigma_Inv(i) * ((fabs(b_new) > tB) * b_new - (fabs(b) > tB) * b) * (B.row(i) * S_XX.col(j) + S_XX.row(j) * B_new.row(i).t()));
+  Log_Sd += Step * (Accepted - Target);
 
-  // Calculate target values with b and b_new
-  double Target1 = Target_B(b_new, phi, eta, nu_2, Trace1_New, Trace2_New);
-  double Target2 = Target_B(b, phi, eta, nu_2, Trace1, Trace2);
+}
 
-  // Calculate r i.e. the difference between two target values
-  double r = Target1 - Target2;
 
-  // Sample u from Uniform(0, 1)
-  double u = Rcpp::runif(1, 0, 1)(0);
+// Calculate log prior of an entry of A or B given its indicator and local scale, as in Target_A and Target_B
+inline double Log_Prior(double x, double z, double scale, double nu) {
 
-  // Compare u and r
-  if (r >= log(u)) {
+  return - z * (x * x / (2 * scale)) - (1 - z) * (0.5 * log(nu) + x * x / (2 * nu * scale));
 
-    // Update b and trace values
-    b = b_new;
+}
 
-    Trace1 = Trace1_New;
-    Trace2 = Trace2_New;
 
-  }
+// Calculate thresholded value of an entry
+inline double Threshold(double x, double t) {
 
-  // Return b and trace values
-  return Rcpp::List::create(Rcpp::Named("b") = b, Rcpp::Named("Trace1") = Trace1,
-                            Rcpp::Named("Trace2") = Trace2);
+  // Return x if its absolute value exceeds t and 0 otherwise
+  return (fabs(x) > t) * x;
 
 }
 
 
-// Calculate target value for a particular A for the model when only Y is there
-// [[Rcpp::export]]
-double Target_A_Star(double a, double N, double gamma, double tau, double nu_1, double Trace3, double Trace4, double Trace5, double logdet) {
+// Return the columns of the nonzero entries of every row of a mask, in increasing order
+inline std::vector<std::vector<arma::uword> > Mask_Support(const arma::mat& Mask) {
 
-  // Calculate Sum term inside exponential in likelihood
-  double Sum = Trace3 + Trace4 + Trace5;
+  std::vector<std::vector<arma::uword> > Support(Mask.n_rows);
 
-  // Calculate Target value
-  double Target = N * logdet - Sum / 2 - gamma * (a * a / (2 * tau)) - (1 - gamma) * (0.5 * log(nu_1) + a * a / (2 * nu_1 * tau));
+  for (arma::uword i = 0; i < Mask.n_rows; i++) {
 
-  // Return Target
-  return Target;
+    for (arma::uword l = 0; l < Mask.n_cols; l++) {
 
-}
+      if (Mask(i, l) != 0) {
 
+        Support[i].push_back(l);
 
+      }
 
+    }
 
-// Sample a particular entry of matrix A for the model when only Y is there
-// [[Rcpp::export]]
-Rcpp::List Sample_A_Star(const arma::mat& S_YY, const arma::mat& A, const arma::mat& A_Pseudo, double i, double j, const arma::colvec& Sigma_Inv, double N, double p, double gamma, double tau, double nu_1, double prop_var1, double tA, double Trace3, double Trace4, double Trace5, arma::mat InvMat, double logdet) {
+  }
 
-  // Value to update
-  double a = A_Pseudo(i, j);
+  return Support;
 
-  // Proposed value
-  double a_new = Rcpp::rnorm(1, a, sqrt(prop_var1))(0);
+}
 
-  // Create a copy of matrix A
-  arma::mat A_new = A;
 
-  // Modify the copy with the proposed a value
-  A_new(i, j) = (fabs(a_new) > tA) * a_new;
+// Sampler state for the A and B updates
+// The state owns A, B, their pseudo versions, the trace values, logdet and (I - A)^(-1),
+// so that a single entry can be proposed and updated in place. A rejected proposal costs O(p + d_i) for A
+// and O(p + d_i) for B, where d_i is the number of instruments of row i, an accepted proposal for A additionally
+// costs an O(p^2) Sherman-Morrison update. B is only nonzero on the support given by D, so sums over a row of B
+// run over the columns in Support[i] only.
+// For the model when only Y is there S_YX and S_XX have no columns and B, Trace1, Trace2 and Trace6 stay 0.
+// With Sparse, (I - A)^(-1) is not held at all. I - A is kept as a sparse LU factorization with low rank updates
+// instead, the entries of (I - A)^(-1) a proposal needs are solved column by column, and an accepted proposal for A
+// costs a sparse solve instead of the O(p^2) update
+struct RGM_State {
+
+  // Summary level data and number of datapoints
+  const arma::mat& S_YY;
+  const arma::mat& S_YX;
+  const arma::mat& S_XX;
+  double N;
+
+  // Whether I - A is kept as a sparse LU factorization instead of a dense inverse
+  bool Sparse;
+
+  // Thresholded and pseudo versions of A and B
+  arma::mat A;
+  arma::mat A_Pseudo;
+  arma::mat B;
+  arma::mat B_Pseudo;
+
+  // Columns of every row of B that may be nonzero, in increasing order
+  std::vector<std::vector<arma::uword> > Support;
+
+  // log(det(I - A)) and (I - A)^(-1), which is empty with Sparse
+  double logdet;
+  arma::mat InvMat;
+
+  // Column and scaled row of the prepared Sherman-Morrison update of InvMat
+  arma::colvec Upd_Col;
+  arma::rowvec Upd_Row;
+
+  // Factorization of I - A with Sparse, and factorization of the pending threshold move
+  Sparse_LU Factor, Trial_Factor;
+
+  // Terms of the quadratic form of every row, not scaled by Sigma_Inv
+  // R3(i) = A_i S_YY_i', R5(i) = A_i S_YY A_i', R6(i) = A_i S_YX B_i', C(i) = S_YX_i B_i' and R2(i) = B_i S_XX B_i'
+  arma::colvec R2, R3, R5, R6, C;
+
+  // Trace values
+  double Trace1, Trace2, Trace3, Trace4, Trace5, Trace6;
+
+  // Entries changed by a pending threshold move and their changes
+  bool Flip_A;
+  std::vector<arma::uword> Flip_Rows;
+  std::vector<arma::uword> Flip_Cols;
+  std::vector<double> Flip_Delta;
+
+  // Capacitance matrix of the pending move, empty if logdet was evaluated in full
+  arma::mat Capacitance;
+
+  // Values saved before the pending move
+  arma::colvec Saved_R2, Saved_R3, Saved_R5, Saved_R6, Saved_C;
+  arma::colvec Saved_Traces;
+  double Saved_logdet;
+
+  // Initialize A, B and their pseudo versions with zeros
+  RGM_State(const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, double N, bool Sparse = false) :
+    S_YY(S_YY), S_YX(S_YX), S_XX(S_XX), N(N), Sparse(Sparse),
+    A(arma::zeros(S_YY.n_cols, S_YY.n_cols)), A_Pseudo(arma::zeros(S_YY.n_cols, S_YY.n_cols)),
+    B(arma::zeros(S_YY.n_cols, S_XX.n_cols)), B_Pseudo(arma::zeros(S_YY.n_cols, S_XX.n_cols)),
+    logdet(0), InvMat(Sparse ? arma::mat() : arma::mat(arma::eye(S_YY.n_cols, S_YY.n_cols))),
+    R2(arma::zeros(S_YY.n_cols)), R3(arma::zeros(S_YY.n_cols)), R5(arma::zeros(S_YY.n_cols)),
+    R6(arma::zeros(S_YY.n_cols)), C(arma::zeros(S_YY.n_cols)),
+    Trace1(0), Trace2(0), Trace3(0), Trace4(0), Trace5(0), Trace6(0),
+    Flip_A(false), Saved_logdet(0) {
+
+    // Factorize I with Sparse
+    if (Sparse) {
+
+      Factor.Factorize(A);
 
-  // Modify logdet
-  double logdet_new = logdet + log(fabs(1 + ((fabs(a) > tA) * a - (fabs(a_new) > tA) * a_new) * InvMat(j, i)));
+    }
 
+    // Every column of B is in the support until Set_Support is called
+    Support.assign(S_YY.n_cols, std::vector<arma::uword>());
 
-  // Calculate new trace values
-  double Trace3_New = Trace3 - N * ((fabs(a_new) > tA) * a_new - (fabs(a) > tA) * a) * Sigma_Inv(i) * S_YY(i, j);
-  double Trace4_New = Trace4 - N * ((fabs(a_new) > tA) * a_new - (fabs(a) > tA) * a) * Sigma_Inv(i) * S_YY(i, j);
-  double Trace5_New = Trace5 + N * ((fabs(a_new) > tA) * a_new - (fabs(a) > tA) * a) * Sigma_Inv(i) * arma::trace(A.row(i) * S_YY.col(j) + S_YY.row(j) * A_new.row(i).t());
+    for (arma::uword i = 0; i < S_YY.n_cols; i++) {
 
-  // Calculate target values with a and a_new
-  double Target1 = Target_A_Star(a_new, N, gamma, tau, nu_1, Trace3_New, Trace4_New, Trace5_New, logdet_new);
-  double Target2 = Target_A_Star(a, N, gamma, tau, nu_1, Trace3, Trace4, Trace5, logdet);
+      for (arma::uword l = 0; l < S_XX.n_cols; l++) {
 
-  // Calculate r i.e. the differnce between two target values
-  double r = Target1 - Target2;
+        Support[i].push_back(l);
 
-  // Sample u from Uniform(0, 1)
-  double u = Rcpp::runif(1, 0, 1)(0);
+      }
 
-  // Compare u and r
-  if (r >= log(u)) {
+    }
 
-    // Update a, trace values, logdet and InvMat
-    a = a_new;
+  }
 
-    Trace3 = Trace3_New;
-    Trace4 = Trace4_New;
-    Trace5 = Trace5_New;
 
-    logdet = logdet_new;
+  // Restrict the support of B to the nonzero entries of D
+  void Set_Support(const arma::mat& D) {
 
-    InvMat = InvMat - (((fabs(a) > tA) * a - (fabs(a_new) > tA) * a_new) / (1 + ((fabs(a) > tA) * a - (fabs(a_new) > tA) * a_new) * InvMat(j, i))) * (InvMat.col(i) * InvMat.row(j));
+    Support = Mask_Support(D);
 
   }
 
-  // Return a, trace values, logdet and InvMat
-  return Rcpp::List::create(Rcpp::Named("a") = a, Rcpp::Named("Trace3") = Trace3,
-                            Rcpp::Named("Trace4") = Trace4, Rcpp::Named("Trace5") = Trace5,
-                            Rcpp::Named("logdet") = logdet, Rcpp::Named("InvMat") = InvMat);
 
-}
+  // Calculate the sum of B(i, l) * x(l) over the support of row i
+  template <typename Vec_Type>
+  double Dot_B(arma::uword i, const Vec_Type& x) const {
 
+    const std::vector<arma::uword>& Cols = Support[i];
+    double Sum = 0;
 
+    for (size_t m = 0; m < Cols.size(); m++) {
 
-// Calculate log-likelihood for the model when only Y is there
-// [[Rcpp::export]]
-double LL_Star(const arma::mat& A, const arma::mat& S_YY, const arma::colvec& Sigma_Inv, double p, double N) {
+      Sum += B(i, Cols[m]) * x(Cols[m]);
 
-  // Calculate (I_p - A)
-  const arma::mat& Mult_Mat = arma::eye(p, p) - A;
+    }
 
-  // Calculate Sum
-  double Sum = N * arma::trace(S_YY * Mult_Mat.t() * arma::diagmat(Sigma_Inv) * Mult_Mat);
+    return Sum;
 
-  // Calculate log-likelihood
-  double LL = N * real(arma::log_det(Mult_Mat)) - N / 2 * accu(log(1/Sigma_Inv)) - Sum / 2 - N / 2 * log(2 * arma::datum::pi);
+  }
 
-  // Return log-likelihood
-  return LL;
 
-}
+  // Recalculate the row terms from A and B
+  void Refresh_Rows() {
 
+    // Calculate S_YX * B' and B_i S_XX B_i' over the support of B
+    arma::mat S_YX_Bt = arma::zeros(S_YX.n_rows, B.n_rows);
 
+    for (arma::uword i = 0; i < B.n_rows; i++) {
 
+      const std::vector<arma::uword>& Cols = Support[i];
 
-// Sample random number from truncated normal
-// [[Rcpp::export]]
-double Sample_tn(double mu, double sigma, double a, double b) {
+      R2(i) = 0;
 
-  // Calculate alpha and beta
-  double alpha = (a - mu) / sigma;
-  double beta = (b - mu) / sigma;
+      for (size_t m = 0; m < Cols.size(); m++) {
 
-  // Calculate CDF
-  double cdf_alpha = arma::normcdf(alpha, 0.0, 1.0);
-  double cdf_beta = arma::normcdf(beta, 0.0, 1.0);
+        double b = B(i, Cols[m]);
 
-  // Sample from truncated normal with mean mu and sd sigma
-  double u = Rcpp::runif(1, cdf_alpha, cdf_beta)(0);
-  double x = R::qnorm(u, 0.0, 1.0, true, false) * sigma + mu;
+        if (b == 0) {
 
-  // Return x
-  return x;
+          continue;
 
-}
+        }
 
+        S_YX_Bt.col(i) += b * S_YX.col(Cols[m]);
+        R2(i) += b * Dot_B(i, S_XX.col(Cols[m]));
 
-// Pdf of truncated normal distribution
-// [[Rcpp::export]]
-double tn_pdf(double x, double mu, double sigma, double a, double b) {
+      }
 
-  // Calculate alpha and beta
-  double alpha = (a - mu) / sigma;
-  double beta = (b - mu) / sigma;
+    }
 
-  // Calculate density
-  double d = arma::normpdf(x, mu, sigma) / (arma::normcdf(beta, 0.0, 1.0) - arma::normcdf(alpha, 0.0, 1.0));
+    // Calculate row terms
+    R3 = arma::sum(A % S_YY, 1);
+    R5 = arma::sum((A * S_YY) % A, 1);
+    R6 = arma::sum(A % S_YX_Bt.t(), 1);
+    C = S_YX_Bt.diag();
 
-  // Return d
-  return d;
+  }
 
-}
 
+  // Recalculate the trace values from the row terms after a change in Sigma_Inv
+  void Rescale(const arma::colvec& Sigma_Inv) {
 
-// Calculate log-likelihood for the model when both X and Y are there
-// [[Rcpp::export]]
-double LL(const arma::mat& A, const arma::mat& B, const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, const arma::colvec& Sigma_Inv, double p, double N) {
+    Trace1 = - 2 * N * arma::dot(Sigma_Inv, C - R6);
+    Trace2 = N * arma::dot(Sigma_Inv, R2);
+    Trace3 = - N * arma::dot(Sigma_Inv, R3);
+    Trace4 = Trace3;
+    Trace5 = N * arma::dot(Sigma_Inv, R5);
+    Trace6 = 2 * N * arma::dot(Sigma_Inv, R6);
 
-  // Calculate (I_p - A)
-  const arma::mat& Mult_Mat = arma::eye(p, p) - A;
+  }
 
-  // Calculate Sum
-  double Sum = N * arma::trace(S_YY * Mult_Mat.t() * arma::diagmat(Sigma_Inv) * Mult_Mat) - 2 * N * arma::trace(S_YX * B.t() * arma::diagmat(Sigma_Inv) * Mult_Mat)
-    + N * arma::trace(S_XX * B.t() * arma::diagmat(Sigma_Inv) * B);
 
-  // Calculate log-likelihood
-  double LL = N * real(arma::log_det(Mult_Mat)) - N / 2 * accu(log(1/Sigma_Inv)) - Sum / 2 - N / 2 * log(2 * arma::datum::pi);
+  // Recalculate everything from A and B to remove accumulated rounding error
+  void Refresh(const arma::colvec& Sigma_Inv) {
 
-  // Return log-likelihood
-  return LL;
+    // Calculate det(I - A) and (I - A)^(-1), or factorize I - A
+    if (Sparse) {
 
-}
+      Factor.Factorize(A);
+      logdet = Factor.Log_Det();
 
+    } else {
 
+      // Calculate I_p - A
+      arma::mat MultMat = arma::eye(A.n_rows, A.n_cols) - A;
 
+      logdet = real(arma::log_det(MultMat));
+      InvMat = arma::inv(MultMat);
 
+    }
 
+    // Calculate row terms and trace values
+    Refresh_Rows();
+    Rescale(Sigma_Inv);
 
+  }
 
-// Do MCMC sampling with threshold prior for the model when both X and Y are there
-// [[Rcpp::export]]
-Rcpp::List RGM_Threshold2(const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, const arma::mat& D, double n, int nIter, int nBurnin, int Thin, double nu_1 = 0.0001, double nu_2 = 0.0001, double a_sigma = 0.01, double b_sigma = 0.01, double Prop_VarA = 0.01, double Prop_VarB = 0.01){
 
+  // Save or restore A, B and everything calculated from them
+  // The values are restored rather than recalculated, so a restored chain carries the same rounding error
+  template <typename Archive>
+  void Serialize(Archive& Ar) {
 
-  // Calculate number of nodes from S_YY matrix
-  int p = S_YY.n_cols;
+    Ar.Matrix(A);
+    Ar.Matrix(A_Pseudo);
+    Ar.Matrix(B);
+    Ar.Matrix(B_Pseudo);
+    Ar.Value(logdet);
+    Ar.Matrix(InvMat);
 
-  // Calculate number of columns of S_XX
-  int k = S_XX.n_cols;
+    if (Sparse) {
 
-  // Initialize A, B, A_Pseudo and B_Pseudo matrices
-  arma::mat A = arma::zeros(p, p);
-  arma::mat B = arma::zeros(p, k);
-  arma::mat A_Pseudo = arma::zeros(p, p);
-  arma::mat B_Pseudo = arma::zeros(p, k);
+      Factor.Serialize(Ar);
 
-  // Initialize Sigma_Inv
-  arma::colvec Sigma_Inv = Rcpp::rgamma(p, a_sigma, 1 / b_sigma);
+    }
 
+    Ar.Matrix(R2);
+    Ar.Matrix(R3);
+    Ar.Matrix(R5);
+    Ar.Matrix(R6);
+    Ar.Matrix(C);
+    Ar.Value(Trace1);
+    Ar.Value(Trace2);
+    Ar.Value(Trace3);
+    Ar.Value(Trace4);
+    Ar.Value(Trace5);
+    Ar.Value(Trace6);
 
-  // Initialize Gamma, Phi, Tau and Eta matrices
-  arma::mat Gamma = arma::ones(p, p);
-  arma::mat Phi = arma::ones(p, k);
-  arma::mat Tau = arma::ones(p, p);
-  arma::mat Eta = arma::ones(p, k);
+  }
 
-  // Make the diagonals of Gamma and Tau matrix to be 0
-  Gamma.diag().zeros();
-  Tau.diag().zeros();
 
-  // Make Phi[i, j] = 0 and Eta[i, j] = 0 if D[i, j] = 0
-  Phi = Phi % D;
-  Eta = Eta % D;
+  // Return entry (j, i) of (I - A)^(-1)
+  double Inv(int j, int i) {
 
-  // Initialize tA, tB, t0 and t_sd
-  double tA = 0;
-  double tB = 0;
-  double t0 = 1;
-  double t_sd = 0.1;
+    return Sparse ? Factor.Entry(j, i) : InvMat(j, i);
 
-  // Initialize acceptance counter
-  double AccptA = 0;
-  double AccptB = 0;
-  double Accpt_tA = 0;
-  double Accpt_tB = 0;
+  }
 
-  // Calculate number of posterior samples
-  int nPst = std::floor((nIter - nBurnin) / Thin);
 
-  // Initiate Itr to index the posterior samples
-  int Itr = 0;
+  // Return column i of (I - A)^(-1), which stays valid until A changes
+  const double* Inv_Column(int i) {
 
-  // Initialize posterior arrays and matrices
-  arma::cube A_Pst = arma::zeros(p, p, nPst);
-  arma::cube A0_Pst = arma::zeros(p, p, nPst);
-  arma::cube B_Pst = arma::zeros(p, k, nPst);
-  arma::cube B0_Pst = arma::zeros(p, k, nPst);
-  arma::cube Gamma_Pst = arma::zeros(p, p, nPst);
-  arma::cube Tau_Pst = arma::zeros(p, p, nPst);
-  arma::cube Phi_Pst = arma::zeros(p, k, nPst);
-  arma::cube Eta_Pst = arma::zeros(p, k, nPst);
-  arma::colvec tA_Pst = arma::zeros(nPst);
-  arma::colvec tB_Pst = arma::zeros(nPst);
-  arma::cube Sigma_Pst = arma::zeros(1, p, nPst);
+    return Sparse ? Factor.Column(i).data() : InvMat.colptr(i);
 
-  // Initialize LogLikelihood vector
-  arma::colvec LL_Pst = arma::zeros(nPst);
+  }
 
 
-  // Run a loop to do MCMC sampling
-  for(int i = 1; i <= nIter; i++){
+  // Update (I - A)^(-1) or the factorization after entry (i, j) of A was changed by Delta
+  void Update_Inverse(int i, int j, double Delta) {
 
-    // Update B
-    // Calculate I_p - A
-    arma::mat MultMat = arma::eye(p, p) - A;
+    if (Delta == 0) {
 
-    // Calculate Trace values
-    double Trace1 = - 2 * n * arma::trace(S_YX * B.t() * arma::diagmat(Sigma_Inv) * MultMat);
-    double Trace2 = n * arma::trace(S_XX * B.t() * arma::diagmat(Sigma_Inv) * B);
+      return;
 
-    // Update Eta based on corresponding b and then update b based on the corresponding eta
-    for (int j = 0; j < p; j++) {
+    }
 
-      for (int l = 0; l < k; l++) {
+    if (Sparse) {
 
-        // Don't update if the corresponding D entry is 0
-        if (D(j, l) != 0) {
+      Factor.Update(i, j, Delta, A);
+      return;
 
-          // Sample Eta
-          Eta(j, l) = Sample_Eta(B_Pseudo(j, l), 1, Eta(j, l), nu_2);
+    }
 
-          // Sample b
-          Rcpp::List Output1 = Sample_B(S_YX, S_XX, B, B_Pseudo, j, l, Sigma_Inv, MultMat, n, 1, Eta(j, l), nu_2, Prop_VarB, tB, Trace1, Trace2);
-          double b = Output1[0];
+    // Sherman-Morrison update of (I - A)^(-1), which does not read A
+    Prepare_Inverse(i, j, Delta);
+    Update_Inverse_Columns(0, InvMat.n_cols);
 
-          // Update acceptance counter
-          if (B_Pseudo(j, l) != b) {
+  }
 
-            // Increase AccptB
-            AccptB = AccptB + 1;
 
-            // Update Trace Values
-            Trace1 = Output1[1];
-            Trace2 = Output1[2];
+  // Prepare the dense Sherman-Morrison update of (I - A)^(-1) after entry (i, j) of A was changed by Delta
+  void Prepare_Inverse(int i, int j, double Delta) {
 
-          }
+    Upd_Col = InvMat.col(i);
+    Upd_Row = InvMat.row(j) * (Delta / (1 - Delta * InvMat(j, i)));
 
-          // Update B_Pseudo, B and Phi
-          B_Pseudo(j, l) = b;
+  }
 
-          B(j, l) = (std::abs(B_Pseudo(j, l)) > tB) * B_Pseudo(j, l);
 
-          Phi(j, l) = (std::abs(B_Pseudo(j, l)) > tB) * 1;
+  // Apply the prepared update to columns First to Last - 1 of (I - A)^(-1)
+  // Every column is updated with the same arithmetic, so the columns can be split across threads
+  void Update_Inverse_Columns(int First, int Last) {
 
-        }
+    for (int l = First; l < Last; l++) {
 
-      }
+      InvMat.col(l) += Upd_Row(l) * Upd_Col;
 
     }
 
-    // Propose tB_new
-    double tB_new = Sample_tn(tB, t_sd, 0, t0);
-
-    // Create B_new
-    arma::mat B_new = B_Pseudo % (arma::abs(B_Pseudo) > tB_new);
-
-    // Calculate difference
-    double Diff = LL(A, B_new, S_YY, S_YX, S_XX, Sigma_Inv, p, n) - LL(A, B, S_YY, S_YX, S_XX, Sigma_Inv, p, n) + log(tn_pdf(tB, tB_new, t_sd, 0, t0)) - log(tn_pdf(tB_new, tB, t_sd, 0, t0));
+  }
 
-    // Compare Diff with log of a random number from Uniform(0, 1)
-    if (Diff > log(Rcpp::runif(1, 0, 1)(0))) {
 
-      // Update B, tB and Accpt_tB
-      B = B_new;
+  // Calculate N * (I - A)_j S (I - A)_j' for row j, where S is the covariance of the residuals
+  double Row_Sum(int j) const {
 
-      tB = tB_new;
+    return N * (S_YY(j, j) - 2 * R3(j) + R5(j) - 2 * (C(j) - R6(j)) + R2(j));
 
-      Accpt_tB = Accpt_tB + 1;
+  }
 
-    }
 
+  // Calculate log-likelihood of the current state
+  double Log_Likelihood(const arma::colvec& Sigma_Inv) const {
 
-    ////////////////////
-    // Update Sigma
-    for (int j = 0; j < p; j++) {
+    // Calculate Sum
+    double Sum = 0;
 
-      // Calculate Sum
-      double z_sum = n * arma::accu(MultMat.row(j) * S_YY * MultMat.row(j).t()) - 2 * n * arma::accu(MultMat.row(j) * S_YX * B.row(j).t()) + n * arma::accu(B.row(j) * S_XX * B.row(j).t());
+    for (arma::uword j = 0; j < A.n_rows; j++) {
 
-      // Sample Sigma_Inv
-      Sigma_Inv(j) = 1 / Sample_Sigma(n, z_sum, a_sigma, b_sigma);
+      Sum += Sigma_Inv(j) * Row_Sum(j);
 
     }
 
+    // Calculate log-likelihood
+    return N * logdet - N / 2 * accu(log(1/Sigma_Inv)) - Sum / 2 - N / 2 * log(2 * arma::datum::pi);
 
-    ////////////////////
-    // Update A
-    // Calculate trace values
-    double Trace3 = - n * arma::trace(S_YY * A.t() * arma::diagmat(Sigma_Inv));
-    double Trace4 = - n * arma::trace(S_YY * arma::diagmat(Sigma_Inv) * A);
-    double Trace5 = n * arma::trace(S_YY * A.t() * arma::diagmat(Sigma_Inv) * A);
-    double Trace6 = 2 * n * arma::trace(S_YX * B.t() * arma::diagmat(Sigma_Inv) * A);
+  }
 
-    // Calculate det(I - A) and (I - A)^(-1)
-    double logdet = real(arma::log_det(MultMat));
-    arma::mat InvMat = arma::inv(MultMat);
 
-    // Update Tau based on a and then update a based on Tau
-    for (int j = 0; j < p; j++) {
+  // Save the row terms, trace values and logdet before a threshold move
+  void Save() {
 
-      for (int l = 0; l < p; l++) {
+    Saved_R2 = R2; Saved_R3 = R3; Saved_R5 = R5; Saved_R6 = R6; Saved_C = C;
+    Saved_Traces = {Trace1, Trace2, Trace3, Trace4, Trace5, Trace6};
+    Saved_logdet = logdet;
 
-        // Don't update the diagonal entries
-        if (l != j) {
+  }
 
-          // Update Tau
-          Tau(j, l) = Sample_Tau(A_Pseudo(j, l), 1, Tau(j, l), nu_1);
 
-          // Sample a
-          Rcpp::List Output2 = Sample_A(S_YY, S_YX, A, A_Pseudo, j, l, Sigma_Inv, n, p, B, 1, Tau(j, l), nu_1, Prop_VarA, tA, Trace3, Trace4, Trace5, Trace6, InvMat, logdet);
-          double a = Output2[0];
+  // Calculate the change in log-likelihood when A is thresholded at tA_new instead of tA
+  // Only the entries with |A_Pseudo| between tA and tA_new change. They are applied to A in place and
+  // Accept_Threshold() or Reject_Threshold() must be called afterwards
+  double Propose_Threshold_A(double tA_new, const arma::colvec& Sigma_Inv) {
 
-          // Update Acceptance counter
-          if (A_Pseudo(j, l) != a) {
+    // Calculate current log-likelihood and save the state
+    double LL_Old = Log_Likelihood(Sigma_Inv);
+    Save();
 
-            // Increase AccptA
-            AccptA = AccptA + 1;
+    Flip_A = true;
+    Flip_Rows.clear();
+    Flip_Cols.clear();
+    Flip_Delta.clear();
 
-            // Update Trace values
-            Trace3 = Output2[1];
-            Trace4 = Output2[2];
-            Trace5 = Output2[3];
-            Trace6 = Output2[4];
+    // Apply the changed entries one by one
+    for (arma::uword j = 0; j < A.n_cols; j++) {
 
-            // Update logdet and (I - A)^(-1)
-            logdet = Output2[5];
-            InvMat = Rcpp::as<arma::mat>(Output2[6]);
+      for (arma::uword i = 0; i < A.n_rows; i++) {
 
+        double Delta = Threshold(A_Pseudo(i, j), tA_new) - A(i, j);
 
-          }
+        if (Delta != 0) {
 
-          // Update A_Pseudo, A and Gamma
-          A_Pseudo(j, l) = a;
+          // Update row terms of row i
+          R3(i) += Delta * S_YY(i, j);
+          R5(i) += Delta * (arma::dot(A.row(i), S_YY.col(j)) + arma::dot(S_YY.row(j), A.row(i)) + Delta * S_YY(j, j));
+          R6(i) += Delta * arma::dot(B.row(i), S_YX.row(j));
 
-          A(j, l) = (std::abs(A_Pseudo(j, l)) > tA) * A_Pseudo(j, l);
+          // Update A
+          A(i, j) += Delta;
 
-          Gamma(j, l) = (std::abs(A_Pseudo(j, l)) > tA) * 1;
+          Flip_Rows.push_back(i);
+          Flip_Cols.push_back(j);
+          Flip_Delta.push_back(Delta);
 
         }
 
@@ -658,745 +681,3579 @@ Rcpp::List RGM_Threshold2(const arma::mat& S_YY, const arma::mat& S_YX, const ar
 
     }
 
-    // Propose tA_new
-    double tA_new = Sample_tn(tA, t_sd, 0, t0);
+    // Calculate number of changed entries
+    int nFlip = Flip_Delta.size();
 
-    // Create A_new
-    arma::mat A_new = A_Pseudo % (arma::abs(A_Pseudo) > tA_new);
+    // Calculate new logdet
+    double Val, Sign;
 
-    // Calculate Difference
-    double Diff_A = LL(A_new, B, S_YY, S_YX, S_XX, Sigma_Inv, p, n) - LL(A, B, S_YY, S_YX, S_XX, Sigma_Inv, p, n) + log(tn_pdf(tA, tA_new, t_sd, 0, t0)) - log(tn_pdf(tA_new, tA, t_sd, 0, t0));
+    if (nFlip == 0) {
 
-    // Compare Diff with log of a random number from uniform(0, 1)
-    if (Diff_A > log(Rcpp::runif(1, 0, 1)(0))) {
+      Capacitance.reset();
 
-      // Update A, tA and Accpt_tA
-      A = A_new;
+    } else if (Sparse) {
 
-      tA = tA_new;
+      // Factorize the proposed I - A, which replaces the factorization if the move is accepted
+      Capacitance.reset();
 
-      Accpt_tA = Accpt_tA + 1;
+      Trial_Factor.Factorize(A);
+      logdet = Trial_Factor.Log_Det();
 
-    }
+    } else if (nFlip <= (int) A.n_rows / 4) {
+
+      // Calculate det(I - A_new) = det(I - A) * det(K) with the nFlip x nFlip capacitance matrix
+      // K(a, b) = 1(a = b) - (I - A)^(-1)(j_a, i_b) * Delta_b
+      Capacitance = arma::eye(nFlip, nFlip);
+
+      for (int a = 0; a < nFlip; a++) {
+
+        for (int b = 0; b < nFlip; b++) {
 
+          Capacitance(a, b) -= InvMat(Flip_Cols[a], Flip_Rows[b]) * Flip_Delta[b];
 
-    // Store posterior samples
-    if((i > nBurnin) && (i % Thin == 0)){
+        }
+
+      }
+
+      arma::log_det(Val, Sign, Capacitance);
+      logdet = logdet + Val;
 
-      A_Pst.slice(Itr) = A;
-      A0_Pst.slice(Itr) = A_Pseudo;
-      B_Pst.slice(Itr) = B;
-      B0_Pst.slice(Itr) = B_Pseudo;
-      Gamma_Pst.slice(Itr) = Gamma;
-      Tau_Pst.slice(Itr) = Tau;
-      Phi_Pst.slice(Itr) = Phi;
-      Eta_Pst.slice(Itr) = Eta;
-      tA_Pst(Itr) = tA;
-      tB_Pst(Itr) = tB;
-      Sigma_Pst.slice(Itr) = 1 / Sigma_Inv.t();
-      LL_Pst(Itr) = LL(A, B, S_YY, S_YX, S_XX, Sigma_Inv, p, n);
+    } else {
 
-      // Increase Itr by 1
-      Itr = Itr + 1;
+      // Too many changed entries for a low rank update, evaluate in full
+      Capacitance.reset();
+
+      arma::log_det(Val, Sign, arma::eye(A.n_rows, A.n_cols) - A);
+      logdet = Val;
 
     }
 
+    // Rescale trace values and return the change in log-likelihood
+    Rescale(Sigma_Inv);
+
+    return Log_Likelihood(Sigma_Inv) - LL_Old;
 
   }
 
-  // Calculate estimates based on posterior samples
-  arma::mat A_Est = mean(A_Pst, 2);
-  arma::mat B_Est = mean(B_Pst, 2);
-  arma::mat A0_Est = mean(A0_Pst, 2);
-  arma::mat B0_Est = mean(B0_Pst, 2);
-  arma::mat Gamma_Est = mean(Gamma_Pst, 2);
-  arma::mat Tau_Est = mean(Tau_Pst, 2);
-  arma::mat Phi_Est = mean(Phi_Pst, 2);
-  arma::mat Eta_Est = mean(Eta_Pst, 2);
-  double tA_Est = mean(tA_Pst);
-  double tB_Est = mean(tB_Pst);
-  arma::mat Sigma_Est = mean(Sigma_Pst, 2);
 
-  // Construct the graph structures
-  arma::umat logicalGraph_A = (Gamma_Est > 0.5);
-  arma::umat logicalGraph_B = (Phi_Est > 0.5);
-  arma::mat zA_Est = arma::conv_to<arma::mat>::from(logicalGraph_A);
-  arma::mat zB_Est = arma::conv_to<arma::mat>::from(logicalGraph_B);
+  // Calculate the change in log-likelihood when B is thresholded at tB_new instead of tB
+  // Only the entries with |B_Pseudo| between tB and tB_new change. They are applied to B in place and
+  // Accept_Threshold() or Reject_Threshold() must be called afterwards
+  double Propose_Threshold_B(double tB_new, const arma::colvec& Sigma_Inv) {
 
+    // Calculate current log-likelihood and save the state
+    double LL_Old = Log_Likelihood(Sigma_Inv);
+    Save();
 
-  // Return outputs
-  return Rcpp::List::create(Rcpp::Named("A_Est") = A_Est, Rcpp::Named("B_Est") = B_Est,
-                            Rcpp::Named("zA_Est") = zA_Est, Rcpp::Named("zB_Est") = zB_Est,
-                            Rcpp::Named("A0_Est") = A0_Est, Rcpp::Named("B0_Est") = B0_Est,
-                            Rcpp::Named("Gamma_Est") = Gamma_Est, Rcpp::Named("Tau_Est") = Tau_Est,
-                            Rcpp::Named("Phi_Est") = Phi_Est, Rcpp::Named("Eta_Est") = Eta_Est,
-                            Rcpp::Named("tA_Est") = tA_Est, Rcpp::Named("tB_Est") = tB_Est,
-                            Rcpp::Named("Sigma_Est") = Sigma_Est,
-                            Rcpp::Named("AccptA") = AccptA / (p * (p - 1) * nIter) * 100, Rcpp::Named("AccptB") = AccptB / (arma::accu(D) * nIter) * 100,
-                            Rcpp::Named("Accpt_tA") = Accpt_tA / (nIter) * 100, Rcpp::Named("Accpt_tB") = Accpt_tB / (nIter) * 100,
-                            Rcpp::Named("LL_Pst") = LL_Pst, Rcpp::Named("Gamma_Pst") = Gamma_Pst);
+    Flip_A = false;
+    Flip_Rows.clear();
+    Flip_Cols.clear();
+    Flip_Delta.clear();
 
+    // Apply the changed entries one by one, logdet does not depend on B
+    for (arma::uword i = 0; i < B.n_rows; i++) {
 
+      for (size_t m = 0; m < Support[i].size(); m++) {
 
-}
+        arma::uword j = Support[i][m];
+        double Delta = Threshold(B_Pseudo(i, j), tB_new) - B(i, j);
+
+        if (Delta != 0) {
 
+          // Update row terms of row i
+          C(i) += Delta * S_YX(i, j);
+          R6(i) += Delta * arma::dot(A.row(i), S_YX.col(j));
+          R2(i) += Delta * (Dot_B(i, S_XX.col(j)) + Dot_B(i, S_XX.row(j)) + Delta * S_XX(j, j));
 
+          // Update B
+          B(i, j) += Delta;
 
+          Flip_Rows.push_back(i);
+          Flip_Cols.push_back(j);
+          Flip_Delta.push_back(Delta);
 
-// Do MCMC sampling with Spike and Slab Prior for the model when both X and Y are there
-// [[Rcpp::export]]
-Rcpp::List RGM_SpikeSlab2(const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, const arma::mat& D, double n, int nIter, int nBurnin, int Thin, double a_rho = 3.0, double b_rho = 1.0, double nu_1 = 0.001, double a_psi = 0.5, double b_psi = 0.5, double nu_2 = 0.0001, double a_sigma = 0.01, double b_sigma = 0.01, double Prop_VarA = 0.01, double Prop_VarB = 0.01){
+        }
 
+      }
 
-  // Calculate number of nodes from S_YY matrix
-  int p = S_YY.n_cols;
+    }
 
-  // Calculate number of columns of S_XX
-  int k = S_XX.n_cols;
+    // Rescale trace values and return the change in log-likelihood
+    Rescale(Sigma_Inv);
 
-  // Initialize matrix A, B
-  arma::mat A = arma::zeros(p, p);
-  arma::mat B = arma::zeros(p, k);
+    return Log_Likelihood(Sigma_Inv) - LL_Old;
 
-  // Initialize Sigma_Inv
-  arma::colvec Sigma_Inv = Rcpp::rgamma(p, a_sigma, 1 / b_sigma);
+  }
 
-  // Initialize Rho, Psi, Gamma, Phi, Tau and Eta matrices
-  arma::mat Rho = arma::zeros(p, p);
-  arma::mat Psi = arma::zeros(p, k);
-  arma::mat Gamma = arma::ones(p, p);
-  arma::mat Phi = arma::ones(p, k);
-  arma::mat Tau = arma::ones(p, p);
-  arma::mat Eta = arma::ones(p, k);
 
-  // Make the diagonals of Gamma and Tau matrix to be 0
-  Gamma.diag().zeros();
-  Tau.diag().zeros();
+  // Keep the pending threshold move
+  void Accept_Threshold() {
 
-  // Make Phi[i, j] = 0 and Eta[i, j] = 0 if D[i, j] = 0
-  Phi = Phi % D;
-  Eta = Eta % D;
+    // Calculate number of changed entries
+    int nFlip = Flip_Delta.size();
 
-  // Initialize acceptance counter
-  double AccptA = 0;
-  double AccptB = 0;
+    // B does not enter (I - A)^(-1)
+    if (!Flip_A || nFlip == 0) {
 
-  // Calculate number of posterior samples
-  int nPst = std::floor((nIter - nBurnin) / Thin);
+      return;
 
-  // Initialize Itr to index the posterior samples
-  int Itr = 0;
+    }
 
-  // Initialize posterior arrays and matrices
-  arma::cube A_Pst = arma::zeros(p, p, nPst);
-  arma::cube B_Pst = arma::zeros(p, k, nPst);
-  arma::cube Gamma_Pst = arma::zeros(p, p, nPst);
-  arma::cube Tau_Pst = arma::zeros(p, p, nPst);
-  arma::cube Rho_Pst = arma::zeros(p, p, nPst);
-  arma::cube Phi_Pst = arma::zeros(p, k, nPst);
-  arma::cube Eta_Pst = arma::zeros(p, k, nPst);
-  arma::cube Psi_Pst = arma::zeros(p, k, nPst);
-  arma::cube Sigma_Pst = arma::zeros(1, p, nPst);
+    if (Sparse) {
 
-  // Initialize LogLikelihood vector
-  arma::colvec LL_Pst = arma::zeros(nPst);
+      // Keep the factorization of the proposed matrix
+      std::swap(Factor, Trial_Factor);
 
+    } else if (Capacitance.is_empty()) {
 
-  // Run a loop to do MCMC sampling
-  for(int i = 1; i <= nIter; i++){
+      // Invert in full
+      InvMat = arma::inv(arma::eye(A.n_rows, A.n_cols) - A);
 
-    // Update B
-    // Calculate I_p - A
-    arma::mat MultMat = arma::eye(p, p) - A;
+    } else {
 
-    // Calculate trace values
-    double Trace1 = -2 * n * arma::trace(S_YX * B.t() * arma::diagmat(Sigma_Inv) * MultMat);
-    double Trace2 = n * arma::trace(S_XX * B.t() * arma::diagmat(Sigma_Inv) * B);
+      // Woodbury update (I - A_new)^(-1) = (I - A)^(-1) + U K^(-1) V with U = (I - A)^(-1)[, i] * Delta and V = (I - A)^(-1)[j, ]
+      arma::mat U(A.n_rows, nFlip);
+      arma::mat V(nFlip, A.n_cols);
 
-    // Update Psi, Eta, Phi and b
-    for (int j = 0; j < p; j++) {
+      for (int a = 0; a < nFlip; a++) {
 
-      for (int l = 0; l < k; l++) {
+        U.col(a) = InvMat.col(Flip_Rows[a]) * Flip_Delta[a];
+        V.row(a) = InvMat.row(Flip_Cols[a]);
 
-        // Don't update if the corresponding D entry is 0
-        if (D(j, l) != 0) {
+      }
 
-          // Sample Psi
-          Psi(j, l) = Sample_Psi(Phi(j, l), a_psi, b_psi);
+      InvMat += U * arma::solve(Capacitance, V);
 
-          // Sample Eta
-          Eta(j, l) = Sample_Eta(B(j, l), Phi(j, l), Eta(j, l), nu_2);
+    }
 
-          // Sample Phi
-          Phi(j, l) = Sample_Phi(B(j, l), Eta(j, l), Psi(j, l), nu_2);
+  }
 
-          // Sample b
-          Rcpp::List Output1 = Sample_B(S_YX, S_XX, B, B, j, l, Sigma_Inv, MultMat, n, Phi(j, l), Eta(j, l), nu_2, Prop_VarB, -1, Trace1, Trace2);
-          double b = Output1[0];
 
-          // Update acceptance counter
-          if (B(j, l) != b) {
+  // Undo the pending threshold move
+  void Reject_Threshold() {
 
-            // Increase AccptB
-            AccptB = AccptB + 1;
+    // Restore the changed entries
+    arma::mat& Target = Flip_A ? A : B;
 
-            // Update Trace Values
-            Trace1 = Output1[1];
-            Trace2 = Output1[2];
+    for (size_t a = 0; a < Flip_Delta.size(); a++) {
 
-          }
+      Target(Flip_Rows[a], Flip_Cols[a]) -= Flip_Delta[a];
 
-          // Update B
-          B(j, l) = b;
+    }
 
-        }
+    // Restore row terms, trace values and logdet
+    R2 = Saved_R2; R3 = Saved_R3; R5 = Saved_R5; R6 = Saved_R6; C = Saved_C;
+    Trace1 = Saved_Traces(0); Trace2 = Saved_Traces(1); Trace3 = Saved_Traces(2);
+    Trace4 = Saved_Traces(3); Trace5 = Saved_Traces(4); Trace6 = Saved_Traces(5);
+    logdet = Saved_logdet;
 
-      }
+  }
 
-    }
 
+  // Proposed value of an entry of A with its target difference and the changes it makes when accepted
+  struct A_Proposal {
 
+    double a_new, Delta, logdet_new, r;
+    double Delta3, Delta5, Delta6;
+    double Trace3_New, Trace4_New, Trace5_New, Trace6_New;
 
-    ////////////////////
-    // Update Sigma
-    for (int j = 0; j < p; j++) {
+  };
 
-      // Calculate Sum
-      double z_sum = n * arma::accu(MultMat.row(j) * S_YY * MultMat.row(j).t()) - 2 * n * arma::accu(MultMat.row(j) * S_YX * B.row(j).t()) + n * arma::accu(B.row(j) * S_XX * B.row(j).t());
 
-      // Sample Sigma_Inv
-      Sigma_Inv(j) = 1 / Sample_Sigma(n, z_sum, a_sigma, b_sigma);
+  // Evaluate the proposal a_new for entry (i, j) of A against the current state without changing it
+  // m is (I - A)^(-1)(j, i). With Thresholded the proposal moves A_Pseudo and A is A_Pseudo thresholded at tA,
+  // otherwise it moves A itself, tA is ignored and A_Pseudo is not used. Without Has_X there is no B and the terms
+  // involving B are skipped
+  template <bool Thresholded, bool Has_X>
+  A_Proposal Evaluate_A(int i, int j, double a_new, double m, const arma::colvec& Sigma_Inv, double gamma, double tau, double nu_1, double tA) const {
 
-    }
+    A_Proposal P;
 
+    // Value to update
+    double a = Thresholded ? A_Pseudo(i, j) : A(i, j);
 
+    P.a_new = a_new;
 
-    ////////////////////
-    // Update A
-    // Calculate trace values
-    double Trace3 = - n * arma::trace(S_YY * A.t() * arma::diagmat(Sigma_Inv));
-    double Trace4 = - n * arma::trace(S_YY * arma::diagmat(Sigma_Inv) * A);
-    double Trace5 = n * arma::trace(S_YY * A.t() * arma::diagmat(Sigma_Inv) * A);
-    double Trace6 = 2 * n * arma::trace(S_YX * B.t() * arma::diagmat(Sigma_Inv) * A);
+    // Calculate change in the thresholded entry
+    P.Delta = Thresholded ? Threshold(a_new, tA) - Threshold(a, tA) : a_new - a;
 
-    // Calculate logdet and (I - A)^(-1)
-    double logdet = real(arma::log_det(MultMat));
-    arma::mat InvMat = arma::inv(MultMat);
+    // Modify logdet
+    P.logdet_new = logdet + log(fabs(1 - P.Delta * m));
 
-    // Update Rho, Tau, Gamma and a
-    for (int j = 0; j < p; j++) {
+    // Calculate changes in the row terms of row i without forming the proposed matrix
+    P.Delta3 = P.Delta * S_YY(i, j);
+    P.Delta5 = P.Delta * (arma::dot(A.row(i), S_YY.col(j)) + arma::dot(S_YY.row(j), A.row(i)) + P.Delta * S_YY(j, j));
+    P.Delta6 = Has_X ? P.Delta * Dot_B(i, S_YX.row(j)) : 0;
 
-      for (int l = 0; l < p; l++) {
+    // Calculate new trace values
+    P.Trace3_New = Trace3 - N * Sigma_Inv(i) * P.Delta3;
+    P.Trace4_New = Trace4 - N * Sigma_Inv(i) * P.Delta3;
+    P.Trace5_New = Trace5 + N * Sigma_Inv(i) * P.Delta5;
+    P.Trace6_New = Trace6 + 2 * N * Sigma_Inv(i) * P.Delta6;
 
-        // Don't update the diagonal entries
-        if (l != j) {
+    // Calculate target values with a and a_new
+    double Target1 = Target_A(a_new, N, gamma, tau, nu_1, P.Trace3_New, P.Trace4_New, P.Trace5_New, P.Trace6_New, P.logdet_new);
+    double Target2 = Target_A(a, N, gamma, tau, nu_1, Trace3, Trace4, Trace5, Trace6, logdet);
 
-          // Sample Rho
-          Rho(j, l) = Sample_Rho(Gamma(j, l), a_rho, b_rho);
+    // Calculate r i.e. the differnce between two target values
+    P.r = Target1 - Target2;
 
-          // Sample Tau
-          Tau(j, l) = Sample_Tau(A(j, l), Gamma(j, l), Tau(j, l), nu_1);
+    return P;
 
-          // Sample Gamma
-          Gamma(j, l) = Sample_Gamma(A(j, l), Tau(j, l), Rho(j, l), nu_1);
+  }
 
-          // Sample a
-          Rcpp::List Output2 = Sample_A(S_YY, S_YX, A, A, j, l, Sigma_Inv, n, p, B, Gamma(j, l), Tau(j, l), nu_1, Prop_VarA, -1, Trace3, Trace4, Trace5, Trace6, InvMat, logdet);
-          double a = Output2[0];
 
-          // Update acceptance counter
-          if (A(j, l) != a) {
+  // Apply an accepted proposal for entry (i, j) of A
+  // With Defer_Inverse a dense (I - A)^(-1) is not updated, the update is only prepared and the caller applies it
+  // with Update_Inverse_Columns before the next proposal
+  template <bool Thresholded, bool Has_X>
+  void Commit_A(int i, int j, const A_Proposal& P, const arma::colvec& Sigma_Inv, double tA, bool Defer_Inverse = false) {
 
-            // Increase AccptA
-            AccptA = AccptA + 1;
+    // Update A_Pseudo, A, (I - A)^(-1), row terms, trace values and logdet
+    if (Thresholded) {
 
-            // Update trace values
-            Trace3 = Output2[1];
-            Trace4 = Output2[2];
-            Trace5 = Output2[3];
-            Trace6 = Output2[4];
+      A_Pseudo(i, j) = P.a_new;
 
-            // Update logdet and (I - A)^(-1)
-            logdet = Output2[5];
-            InvMat = Rcpp::as<arma::mat>(Output2[6]);
+    }
 
-          }
+    A(i, j) = Thresholded ? Threshold(P.a_new, tA) : P.a_new;
 
-          // Update A
-          A(j, l) = a;
+    if (Defer_Inverse && !Sparse && P.Delta != 0) {
 
-        }
+      Prepare_Inverse(i, j, P.Delta);
 
-      }
+    } else {
+
+      Update_Inverse(i, j, P.Delta);
 
     }
 
+    R3(i) += P.Delta3;
+    R5(i) += P.Delta5;
+
+    Trace3 = P.Trace3_New;
+    Trace4 = P.Trace4_New;
+    Trace5 = P.Trace5_New;
 
-    // Store posterior samples
-    if((i > nBurnin) && (i % Thin == 0)){
+    if (Has_X) {
 
-      A_Pst.slice(Itr) = A;
-      B_Pst.slice(Itr) = B;
-      Gamma_Pst.slice(Itr) = Gamma;
-      Tau_Pst.slice(Itr) = Tau;
-      Rho_Pst.slice(Itr) = Rho;
-      Phi_Pst.slice(Itr) = Phi;
-      Eta_Pst.slice(Itr) = Eta;
-      Psi_Pst.slice(Itr) = Psi;
-      Sigma_Pst.slice(Itr) = 1 / Sigma_Inv.t();
-      LL_Pst(Itr) = LL(A, B, S_YY, S_YX, S_XX, Sigma_Inv, p, n);
+      R6(i) += P.Delta6;
 
-      // Increase Itr by 1
-      Itr = Itr + 1;
+      Trace1 = Trace1 + 2 * N * Sigma_Inv(i) * P.Delta6;
+      Trace6 = P.Trace6_New;
 
     }
 
+    logdet = P.logdet_new;
 
   }
 
-  // Calculate estimates based on posterior samples
-  arma::mat A_Est = mean(A_Pst, 2);
-  arma::mat B_Est = mean(B_Pst, 2);
-  arma::mat Gamma_Est = mean(Gamma_Pst, 2);
-  arma::mat Tau_Est = mean(Tau_Pst, 2);
-  arma::mat Rho_Est = mean(Rho_Pst, 2);
-  arma::mat Phi_Est = mean(Phi_Pst, 2);
-  arma::mat Eta_Est = mean(Eta_Pst, 2);
-  arma::mat Psi_Est = mean(Psi_Pst, 2);
-  arma::mat Sigma_Est = mean(Sigma_Pst, 2);
 
-  // Construct the graph structures
-  arma::umat logicalGraph_A = (Gamma_Est > 0.5);
-  arma::umat logicalGraph_B = (Phi_Est > 0.5);
-  arma::mat zA_Est = arma::conv_to<arma::mat>::from(logicalGraph_A);
-  arma::mat zB_Est = arma::conv_to<arma::mat>::from(logicalGraph_B);
+  // Sample entry (i, j) of A in place and return whether the proposal was accepted
+  template <bool Thresholded, bool Has_X>
+  bool Sample_A(RGM_RNG& RNG, int i, int j, const arma::colvec& Sigma_Inv, double gamma, double tau, double nu_1, double prop_var1, double tA) {
 
-  // Return outputs
-  return Rcpp::List::create(Rcpp::Named("A_Est") = A_Est, Rcpp::Named("B_Est") = B_Est,
-                            Rcpp::Named("zA_Est") = zA_Est, Rcpp::Named("zB_Est") = zB_Est,
-                            Rcpp::Named("Gamma_Est") = Gamma_Est, Rcpp::Named("Tau_Est") = Tau_Est,
-                            Rcpp::Named("Rho_Est") = Rho_Est, Rcpp::Named("Phi_Est") = Phi_Est,
-                            Rcpp::Named("Eta_Est") = Eta_Est, Rcpp::Named("Psi_Est") = Psi_Est,
-                            Rcpp::Named("Sigma_Est") = Sigma_Est,
-                            Rcpp::Named("AccptA") = AccptA / (p * (p - 1) * nIter) * 100, Rcpp::Named("AccptB") = AccptB / (arma::accu(D) * nIter) * 100,
-                            Rcpp::Named("LL_Pst") = LL_Pst, Rcpp::Named("Gamma_Pst") = Gamma_Pst);
+    // Value to update
+    double a = Thresholded ? A_Pseudo(i, j) : A(i, j);
 
+    // Propose and evaluate a new value
+    double a_new = RNG.Normal(a, sqrt(prop_var1));
 
-}
-
+    A_Proposal P = Evaluate_A<Thresholded, Has_X>(i, j, a_new, Inv(j, i), Sigma_Inv, gamma, tau, nu_1, tA);
 
+    // Sample u from Uniform(0, 1)
+    double u = RNG.Uniform(0, 1);
 
-// Do MCMC sampling with threshold prior for the model when only Y is there
-// [[Rcpp::export]]
-Rcpp::List RGM_Threshold1(const arma::mat& S_YY, double n, int nIter, int nBurnin, int Thin, double nu_1 = 0.0001, double a_sigma = 0.01, double b_sigma = 0.01, double Prop_VarA = 0.01){
+    // Compare u and r
+    if (P.r < log(u)) {
 
+      // Keep the current state
+      return false;
 
-  // Calculate number of nodes from S_YY matrix
-  int p = S_YY.n_cols;
+    }
 
+    Commit_A<Thresholded, Has_X>(i, j, P, Sigma_Inv, tA);
 
-  // Initialize A, A_Pseudo matrices
-  arma::mat A = arma::zeros(p, p);
-  arma::mat A_Pseudo = arma::zeros(p, p);
+    // Return acceptance
+    return true;
 
-  // Initialize Sigma_Inv
-  arma::colvec Sigma_Inv = Rcpp::rgamma(p, a_sigma, 1 / b_sigma);
+  }
 
 
-  // Initialize Gamma and Tau matrices
-  arma::mat Gamma = arma::ones(p, p);
-  arma::mat Tau = arma::ones(p, p);
+  // Sample the reciprocal entries (i, j) and (j, i) of A jointly in place and return whether the proposal was accepted
+  // Both entries are proposed by independent random walks with variances prop_var1 and prop_var2 and accepted together. With the changes d1 and d2,
+  // I - A_new = (I - A) - U V' with U = [d1 e_i, d2 e_j] and V = [e_j, e_i], so by the matrix determinant lemma
+  // det(I - A_new) = det(I - A) det(K) with the 2 x 2 matrix K = I_2 - V' (I - A)^(-1) U, and (I - A)^(-1) is
+  // updated by the rank 2 Woodbury identity. The entries are in different rows, so their row terms change separately
+  template <bool Thresholded, bool Has_X>
+  bool Sample_A_Pair(RGM_RNG& RNG, int i, int j, const arma::colvec& Sigma_Inv, double gamma1, double tau1, double gamma2, double tau2, double nu_1, double prop_var1, double prop_var2, double tA) {
 
-  // Make the diagonals of Gamma and Tau matrices to be 0
-  Gamma.diag().zeros();
-  Tau.diag().zeros();
+    // Values to update
+    double a1 = Thresholded ? A_Pseudo(i, j) : A(i, j);
+    double a2 = Thresholded ? A_Pseudo(j, i) : A(j, i);
 
+    // Proposed values
+    double a1_new = RNG.Normal(a1, sqrt(prop_var1));
+    double a2_new = RNG.Normal(a2, sqrt(prop_var2));
 
+    // Calculate changes in the thresholded entries
+    double d1 = Thresholded ? Threshold(a1_new, tA) - Threshold(a1, tA) : a1_new - a1;
+    double d2 = Thresholded ? Threshold(a2_new, tA) - Threshold(a2, tA) : a2_new - a2;
 
-  // Initialize tA, t0 and t_sd
-  double tA = 0;
-  double t0 = 1;
-  double t_sd = 0.1;
+    // Calculate K and modify logdet, reading the entries of (I - A)^(-1) column by column
+    double Inv_ji = Inv(j, i), Inv_ii = Inv(i, i);
+    double Inv_jj = Inv(j, j), Inv_ij = Inv(i, j);
 
-  // Initialize acceptance counter
-  double AccptA = 0;
-  double Accpt_tA = 0;
+    double K11 = 1 - Inv_ji * d1, K12 = - Inv_jj * d2;
+    double K21 = - Inv_ii * d1, K22 = 1 - Inv_ij * d2;
+    double detK = K11 * K22 - K12 * K21;
 
-  // Calculate number of posterior samples
-  int nPst = std::floor((nIter - nBurnin) / Thin);
+    double logdet_new = logdet + log(fabs(detK));
 
-  // Initiate Itr to index the posterior samples
-  int Itr = 0;
+    // Calculate changes in the row terms of rows i and j without forming the proposed matrix
+    double Delta3_i = d1 * S_YY(i, j);
+    double Delta5_i = d1 * (arma::dot(A.row(i), S_YY.col(j)) + arma::dot(S_YY.row(j), A.row(i)) + d1 * S_YY(j, j));
+    double Delta6_i = Has_X ? d1 * Dot_B(i, S_YX.row(j)) : 0;
 
-  // Initialize posterior arrays and matrices
-  arma::cube A_Pst = arma::zeros(p, p, nPst);
-  arma::cube A0_Pst = arma::zeros(p, p, nPst);
-  arma::cube Gamma_Pst = arma::zeros(p, p, nPst);
-  arma::cube Tau_Pst = arma::zeros(p, p, nPst);
-  arma::colvec tA_Pst = arma::zeros(nPst);
-  arma::cube Sigma_Pst = arma::zeros(1, p, nPst);
+    double Delta3_j = d2 * S_YY(j, i);
+    double Delta5_j = d2 * (arma::dot(A.row(j), S_YY.col(i)) + arma::dot(S_YY.row(i), A.row(j)) + d2 * S_YY(i, i));
+    double Delta6_j = Has_X ? d2 * Dot_B(j, S_YX.row(i)) : 0;
 
-  // Initialize LogLikelihood vector
-  arma::colvec LL_Pst = arma::zeros(nPst);
+    // Calculate changes in the trace values
+    double Delta3 = N * (Sigma_Inv(i) * Delta3_i + Sigma_Inv(j) * Delta3_j);
+    double Delta5 = N * (Sigma_Inv(i) * Delta5_i + Sigma_Inv(j) * Delta5_j);
+    double Delta6 = N * (Sigma_Inv(i) * Delta6_i + Sigma_Inv(j) * Delta6_j);
 
+    // Calculate r i.e. the difference between two target values, the prior of the second entry is added separately
+    double r = Target_A(a1_new, N, gamma1, tau1, nu_1, Trace3 - Delta3, Trace4 - Delta3, Trace5 + Delta5, Trace6 + 2 * Delta6, logdet_new) -
+      Target_A(a1, N, gamma1, tau1, nu_1, Trace3, Trace4, Trace5, Trace6, logdet) +
+      Log_Prior(a2_new, gamma2, tau2, nu_1) - Log_Prior(a2, gamma2, tau2, nu_1);
 
-  // Run a loop to do MCMC sampling
-  for(int i = 1; i <= nIter; i++){
+    // Sample u from Uniform(0, 1)
+    double u = RNG.Uniform(0, 1);
 
+    // Compare u and r
+    if (r < log(u)) {
 
-    // Calculate I_p - A
-    arma::mat MultMat = arma::eye(p, p) - A;
+      // Keep the current state
+      return false;
 
+    }
 
-    ////////////////////
-    // Update Sigma
-    for (int j = 0; j < p; j++) {
+    // Woodbury update (I - A_new)^(-1) = (I - A)^(-1) + (I - A)^(-1) U K^(-1) V' (I - A)^(-1)
+    if (!Sparse && (d1 != 0 || d2 != 0)) {
 
-      // Calculate Sum
-      double z_sum = n * arma::accu(MultMat.row(j) * S_YY * MultMat.row(j).t());
+      arma::colvec U1 = InvMat.col(i) * d1;
+      arma::colvec U2 = InvMat.col(j) * d2;
 
-      // Sample Sigma_Inv
-      Sigma_Inv(j) = 1 / Sample_Sigma(n, z_sum, a_sigma, b_sigma);
+      // Rows of K^(-1) V' (I - A)^(-1)
+      arma::rowvec W1 = (K22 * InvMat.row(j) - K12 * InvMat.row(i)) / detK;
+      arma::rowvec W2 = (K11 * InvMat.row(i) - K21 * InvMat.row(j)) / detK;
 
-    }
+      for (arma::uword l = 0; l < InvMat.n_cols; l++) {
 
+        InvMat.col(l) += W1(l) * U1 + W2(l) * U2;
 
-    ////////////////////
-    // Update A
-    // Calculate trace values
-    double Trace3 = - n * arma::trace(S_YY * A.t() * arma::diagmat(Sigma_Inv));
-    double Trace4 = - n * arma::trace(S_YY * arma::diagmat(Sigma_Inv) * A);
-    double Trace5 = n * arma::trace(S_YY * A.t() * arma::diagmat(Sigma_Inv) * A);
+      }
 
-    // Calculate det(I - A) and (I - A)^(-1)
-    double logdet = real(arma::log_det(MultMat));
-    arma::mat InvMat = arma::inv(MultMat);
+    }
 
-    // Update Tau based on a and then update a based on Tau
-    for (int j = 0; j < p; j++) {
+    // Update A_Pseudo, A, row terms, trace values and logdet
+    if (Thresholded) {
 
-      for (int l = 0; l < p; l++) {
+      A_Pseudo(i, j) = a1_new;
+      A_Pseudo(j, i) = a2_new;
 
-        // Don't update the diagonal entries
-        if (l != j) {
+    }
 
-          // Update Tau
-          Tau(j, l) = Sample_Tau(A_Pseudo(j, l), 1, Tau(j, l), nu_1);
+    A(i, j) = Thresholded ? Threshold(a1_new, tA) : a1_new;
 
-          // Sample a
-          Rcpp::List Output2 = Sample_A_Star(S_YY, A, A_Pseudo, j, l, Sigma_Inv, n, p, 1, Tau(j, l), nu_1, Prop_VarA, tA, Trace3, Trace4, Trace5,  InvMat, logdet);
-          double a = Output2[0];
+    // The factorization takes the two changes one after the other
+    if (Sparse) {
 
-          // Update Acceptance counter
-          if (A_Pseudo(j, l) != a) {
+      Update_Inverse(i, j, d1);
 
-            // Increase AccptA
-            AccptA = AccptA + 1;
+    }
 
-            // Update Trace values
-            Trace3 = Output2[1];
-            Trace4 = Output2[2];
-            Trace5 = Output2[3];
+    A(j, i) = Thresholded ? Threshold(a2_new, tA) : a2_new;
 
-            // Update logdet and (I - A)^(-1)
-            logdet = Output2[4];
-            InvMat = Rcpp::as<arma::mat>(Output2[5]);
+    if (Sparse) {
 
+      Update_Inverse(j, i, d2);
 
-          }
+    }
 
-          // Update A_Pseudo, A and Gamma
-          A_Pseudo(j, l) = a;
+    R3(i) += Delta3_i; R3(j) += Delta3_j;
+    R5(i) += Delta5_i; R5(j) += Delta5_j;
 
-          A(j, l) = (std::abs(A_Pseudo(j, l)) > tA) * A_Pseudo(j, l);
+    Trace3 = Trace3 - Delta3;
+    Trace4 = Trace4 - Delta3;
+    Trace5 = Trace5 + Delta5;
 
-          Gamma(j, l) = (std::abs(A_Pseudo(j, l)) > tA) * 1;
+    if (Has_X) {
 
-        }
+      R6(i) += Delta6_i; R6(j) += Delta6_j;
 
-      }
+      Trace1 = Trace1 + 2 * Delta6;
+      Trace6 = Trace6 + 2 * Delta6;
 
     }
 
-    // Propose tA_new
-    double tA_new = Sample_tn(tA, t_sd, 0, t0);
+    logdet = logdet_new;
 
-    // Create A_new
-    arma::mat A_new = A_Pseudo % (arma::abs(A_Pseudo) > tA_new);
+    // Return acceptance
+    return true;
 
-    // Calculate Difference
-    double Diff_A = LL_Star(A_new, S_YY, Sigma_Inv, p, n) - LL_Star(A, S_YY, Sigma_Inv, p, n) + log(tn_pdf(tA, tA_new, t_sd, 0, t0)) - log(tn_pdf(tA_new, tA, t_sd, 0, t0));
+  }
 
-    // Compare Diff with log of a random number from uniform(0, 1)
-    if (Diff_A > log(Rcpp::runif(1, 0, 1)(0))) {
 
-      // Update A, tA and Accpt_tA
-      A = A_new;
+  // Trace values changed by the proposals of B
+  struct B_Traces {
 
-      tA = tA_new;
+    double Trace1, Trace2, Trace6;
 
-      Accpt_tA = Accpt_tA + 1;
+  };
 
-    }
 
+  // Sample entry (i, j) of B in place and return whether the proposal was accepted
+  // With Thresholded the proposal moves B_Pseudo and B is B_Pseudo thresholded at tB, otherwise it moves B itself.
+  // The proposal changes only row i of B and the row terms of row i, and its target difference depends on the
+  // trace values only through their changes, so T may hold the changes made by the proposals of row i alone
+  template <bool Thresholded>
+  bool Sample_B(RGM_RNG& RNG, int i, int j, const arma::colvec& Sigma_Inv, double phi, double eta, double nu_2, double prop_var2, double tB, B_Traces& T) {
 
-    // Store posterior samples
-    if((i > nBurnin) && (i % Thin == 0)){
+    // Value to update
+    double b = Thresholded ? B_Pseudo(i, j) : B(i, j);
 
-      A_Pst.slice(Itr) = A;
-      A0_Pst.slice(Itr) = A_Pseudo;
-      Gamma_Pst.slice(Itr) = Gamma;
-      Tau_Pst.slice(Itr) = Tau;
-      tA_Pst(Itr) = tA;
-      Sigma_Pst.slice(Itr) = 1 / Sigma_Inv.t();
-      LL_Pst(Itr) = LL_Star(A, S_YY, Sigma_Inv, p, n);
+    // Proposed value
+    double b_new = RNG.Normal(b, sqrt(prop_var2));
 
-      // Increase Itr by 1
-      Itr = Itr + 1;
+    // Calculate change in the thresholded entry
+    double Delta = Thresholded ? Threshold(b_new, tB) - Threshold(b, tB) : b_new - b;
 
-    }
+    // Calculate changes in the row terms of row i without forming the proposed matrix
+    double DeltaC = Delta * S_YX(i, j);
+    double Delta6 = Delta * arma::dot(A.row(i), S_YX.col(j));
+    double Delta2 = Delta * (Dot_B(i, S_XX.col(j)) + Dot_B(i, S_XX.row(j)) + Delta * S_XX(j, j));
 
+    // Calculate new trace values
+    double Trace1_New = T.Trace1 - 2 * N * Sigma_Inv(i) * (DeltaC - Delta6);
+    double Trace2_New = T.Trace2 + N * Sigma_Inv(i) * Delta2;
 
-  }
+    // Calculate target values with b and b_new
+    double Target1 = Target_B(b_new, phi, eta, nu_2, Trace1_New, Trace2_New);
+    double Target2 = Target_B(b, phi, eta, nu_2, T.Trace1, T.Trace2);
 
-  // Calculate estimates based on posterior samples
-  arma::mat A_Est = mean(A_Pst, 2);
-  arma::mat A0_Est = mean(A0_Pst, 2);
-  arma::mat Gamma_Est = mean(Gamma_Pst, 2);
-  arma::mat Tau_Est = mean(Tau_Pst, 2);
-  double tA_Est = mean(tA_Pst);
-  arma::mat Sigma_Est = mean(Sigma_Pst, 2);
+    // Calculate r i.e. the difference between two target values
+    double r = Target1 - Target2;
 
-  // Construct the graph structures
-  arma::umat logicalGraph_A = (Gamma_Est > 0.5);
-  arma::mat zA_Est = arma::conv_to<arma::mat>::from(logicalGraph_A);
+    // Sample u from Uniform(0, 1)
+    double u = RNG.Uniform(0, 1);
 
+    // Compare u and r
+    if (r < log(u)) {
 
-  // Return outputs
-  return Rcpp::List::create(Rcpp::Named("A_Est") = A_Est,
-                            Rcpp::Named("zA_Est") = zA_Est,
-                            Rcpp::Named("A0_Est") = A0_Est,
-                            Rcpp::Named("Gamma_Est") = Gamma_Est, Rcpp::Named("Tau_Est") = Tau_Est,
-                            Rcpp::Named("tA_Est") = tA_Est,
-                            Rcpp::Named("Sigma_Est") = Sigma_Est,
-                            Rcpp::Named("AccptA") = AccptA / (p * (p - 1) * nIter) * 100,
-                            Rcpp::Named("Accpt_tA") = Accpt_tA / (nIter) * 100,
-                            Rcpp::Named("LL_Pst") = LL_Pst, Rcpp::Named("Gamma_Pst") = Gamma_Pst);
+      // Keep the current state
+      return false;
 
+    }
 
+    // Update B_Pseudo, B, row terms and trace values
+    if (Thresholded) {
 
-}
+      B_Pseudo(i, j) = b_new;
+
+    }
 
+    B(i, j) = Thresholded ? Threshold(b_new, tB) : b_new;
 
+    C(i) += DeltaC;
+    R6(i) += Delta6;
+    R2(i) += Delta2;
 
+    T.Trace1 = Trace1_New;
+    T.Trace2 = Trace2_New;
+    T.Trace6 = T.Trace6 + 2 * N * Sigma_Inv(i) * Delta6;
 
+    // Return acceptance
+    return true;
 
+  }
 
 
-// Do MCMC sampling with Spike and Slab Prior for the model when only Y is there
-// [[Rcpp::export]]
-Rcpp::List RGM_SpikeSlab1(const arma::mat& S_YY, double n, int nIter, int nBurnin, int Thin, double a_rho = 3.0, double b_rho = 1.0, double nu_1 = 0.001, double a_sigma = 0.01, double b_sigma = 0.01, double Prop_VarA = 0.01){
+  // Sample entry (i, j) of B in place with the trace values of the state
+  template <bool Thresholded>
+  bool Sample_B(RGM_RNG& RNG, int i, int j, const arma::colvec& Sigma_Inv, double phi, double eta, double nu_2, double prop_var2, double tB) {
 
+    B_Traces T = {Trace1, Trace2, Trace6};
 
-  // Calculate number of nodes from S_YY matrix
-  int p = S_YY.n_cols;
+    bool Accepted = Sample_B<Thresholded>(RNG, i, j, Sigma_Inv, phi, eta, nu_2, prop_var2, tB, T);
 
-  // Initialize matrix A
-  arma::mat A = arma::zeros(p, p);
+    Trace1 = T.Trace1;
+    Trace2 = T.Trace2;
+    Trace6 = T.Trace6;
 
-  // Initialize Sigma_Inv
-  arma::colvec Sigma_Inv = Rcpp::rgamma(p, a_sigma, 1 / b_sigma);
+    return Accepted;
 
-  // Initialize Rho, Gamma and Tau matrix
-  arma::mat Rho = arma::zeros(p, p);
-  arma::mat Gamma = arma::ones(p, p);
-  arma::mat Tau = arma::ones(p, p);
+  }
 
-  // Make the diagonals of Gamma and Tau matrix to be 0
-  Gamma.diag().zeros();
-  Tau.diag().zeros();
 
-  // Initialize acceptance counter
-  double AccptA = 0;
+  // Add the trace changes made by the proposals of a row of B
+  void Add_Traces(const B_Traces& T) {
 
-  // Calculate number of posterior samples
-  int nPst = std::floor((nIter - nBurnin) / Thin);
+    Trace1 += T.Trace1;
+    Trace2 += T.Trace2;
+    Trace6 += T.Trace6;
 
-  // Initialize Itr to index the posterior samples
-  int Itr = 0;
+  }
 
-  // Initialize posterior arrays and matrices
-  arma::cube A_Pst = arma::zeros(p, p, nPst);
-  arma::cube Gamma_Pst = arma::zeros(p, p, nPst);
-  arma::cube Tau_Pst = arma::zeros(p, p, nPst);
-  arma::cube Rho_Pst = arma::zeros(p, p, nPst);
-  arma::cube Sigma_Pst = arma::zeros(1, p, nPst);
 
-  // Initialize LogLikelihood vector
-  arma::colvec LL_Pst = arma::zeros(nPst);
+  // Add x to entry (i, j) of A and update (I - A)^(-1), the row terms, trace values and logdet as an accepted proposal does
+  template <bool Has_X>
+  void Change_A(int i, int j, double x, const arma::colvec& Sigma_Inv) {
 
+    if (x == 0) {
 
-  // Run a loop to do MCMC sampling
-  for(int i = 1; i <= nIter; i++){
+      return;
 
-    // Calculate I_p - A
-    arma::mat MultMat = arma::eye(p, p) - A;
+    }
 
-    ////////////////////
-    // Update Sigma
-    for (int j = 0; j < p; j++) {
+    // Calculate changes in the row terms of row i and modify logdet
+    double Delta3 = x * S_YY(i, j);
+    double Delta5 = x * (arma::dot(A.row(i), S_YY.col(j)) + arma::dot(S_YY.row(j), A.row(i)) + x * S_YY(j, j));
+    double Delta6 = Has_X ? x * Dot_B(i, S_YX.row(j)) : 0;
 
-      // Calculate Sum
-      double z_sum = n * arma::accu(MultMat.row(j) * S_YY * MultMat.row(j).t());
+    logdet = logdet + log(fabs(1 - x * Inv(j, i)));
 
-      // Sample Sigma_Inv
-      Sigma_Inv(j) = 1 / Sample_Sigma(n, z_sum, a_sigma, b_sigma);
+    // Update A, (I - A)^(-1), row terms and trace values
+    A(i, j) += x;
 
-    }
+    Update_Inverse(i, j, x);
 
+    R3(i) += Delta3;
+    R5(i) += Delta5;
 
+    Trace3 = Trace3 - N * Sigma_Inv(i) * Delta3;
+    Trace4 = Trace4 - N * Sigma_Inv(i) * Delta3;
+    Trace5 = Trace5 + N * Sigma_Inv(i) * Delta5;
 
-    ////////////////////
-    // Update A
-    // Calculate trace values
-    double Trace3 = - n * arma::trace(S_YY * A.t() * arma::diagmat(Sigma_Inv));
-    double Trace4 = - n * arma::trace(S_YY * arma::diagmat(Sigma_Inv) * A);
-    double Trace5 = n * arma::trace(S_YY * A.t() * arma::diagmat(Sigma_Inv) * A);
+    if (Has_X) {
 
-    // Calculate logdet and (I - A)^(-1)
-    double logdet = real(arma::log_det(MultMat));
-    arma::mat InvMat = arma::inv(MultMat);
+      R6(i) += Delta6;
 
-    // Update Rho, Tau, Gamma and a
-    for (int j = 0; j < p; j++) {
+      Trace1 = Trace1 + 2 * N * Sigma_Inv(i) * Delta6;
+      Trace6 = Trace6 + 2 * N * Sigma_Inv(i) * Delta6;
 
-      for (int l = 0; l < p; l++) {
+    }
 
-        // Don't update the diagonal entries
-        if (l != j) {
+  }
 
-          // Sample Rho
-          Rho(j, l) = Sample_Rho(Gamma(j, l), a_rho, b_rho);
 
-          // Sample Tau
-          Tau(j, l) = Sample_Tau(A(j, l), Gamma(j, l), Tau(j, l), nu_1);
+  // Set entry (i, j) of A to the value that maximizes Target_A given everything else, where d = gamma / tau + (1 - gamma) / (nu_1 tau)
+  // is the precision of its prior. With the change x of the entry and m = (I - A)^(-1)(j, i) the target is
+  // N log|1 - x m| - q x^2 / 2 - h x up to a constant, which is concave on the side of the pole x = 1 / m that contains 0.
+  // Setting its derivative to 0 gives q m x^2 + (h m - q) x - (N m + h) = 0, which has one root on each side.
+  // With Thresholded the value is also kept in A_Pseudo. A root that is not above tA is moved to the nearest value above tA,
+  // which is the best one there as the target is concave, and the entry is set to 0 if that is better
+  template <bool Thresholded, bool Has_X>
+  void Maximize_A(int i, int j, const arma::colvec& Sigma_Inv, double d, double tA) {
 
-          // Sample Gamma
-          Gamma(j, l) = Sample_Gamma(A(j, l), Tau(j, l), Rho(j, l), nu_1);
+    // Calculate coefficients of the target in x
+    double a = A(i, j);
+    double m = Inv(j, i);
+    double s = N * Sigma_Inv(i);
+    double Lin = arma::dot(A.row(i), S_YY.col(j)) + arma::dot(S_YY.row(j), A.row(i)) - 2 * S_YY(i, j) + (Has_X ? 2 * Dot_B(i, S_YX.row(j)) : 0);
+    double q = s * S_YY(j, j) + d;
+    double h = s * Lin / 2 + d * a;
 
-          // Sample a
-          Rcpp::List Output2 = Sample_A_Star(S_YY, A, A, j, l, Sigma_Inv, n, p, Gamma(j, l), Tau(j, l), nu_1, Prop_VarA, -1, Trace3, Trace4, Trace5, InvMat, logdet);
+    // Find the root on the side of the pole that contains 0, which has the smaller x m, avoiding cancellation in the
+    // quadratic formula. Comparing the roots rather than testing x m < 1 is safe when a root is next to the pole
+    double x = - h / q;
 
-          double a = Output2[0];
+    if (m != 0) {
 
-          // Update acceptance counter
-          if (A(j, l) != a) {
+      double Qa = q * m, Qb = h * m - q, Qc = - (N * m + h);
+      double Root = std::sqrt(std::max(Qb * Qb - 4 * Qa * Qc, 0.0));
+      double t = - 0.5 * (Qb + (Qb >= 0 ? Root : - Root));
+      double x1 = t / Qa, x2 = (t != 0) ? Qc / t : x1;
 
-            // Increase AccptA
-            AccptA = AccptA + 1;
+      x = (x1 * m < x2 * m) ? x1 : x2;
 
-            // Update trace values
-            Trace3 = Output2[1];
-            Trace4 = Output2[2];
-            Trace5 = Output2[3];
+    }
 
-            // Update logdet and (I - A)^(-1)
-            logdet = Output2[4];
-            InvMat = Rcpp::as<arma::mat>(Output2[5]);
+    // Move the entry just above the threshold on its side if it is not above it, and keep it only if it beats 0
+    if (Thresholded) {
 
-          }
+      if (fabs(a + x) <= tA) {
 
-          // Update A
-          A(j, l) = a;
+        double Edge = std::nextafter(tA, arma::datum::inf);
 
-        }
+        x = (a + x < 0 ? - Edge : Edge) - a;
 
       }
 
-    }
-
+      double Gain = N * log(fabs(1 - x * m)) - q * x * x / 2 - h * x;
+      double Gain_Zero = N * log(fabs(1 + a * m)) - q * a * a / 2 + h * a;
 
+      if (!(Gain >= Gain_Zero)) {
 
-    // Store posterior samples
-    if((i > nBurnin) && (i % Thin == 0)){
+        x = - a;
 
-      A_Pst.slice(Itr) = A;
-      Gamma_Pst.slice(Itr) = Gamma;
-      Tau_Pst.slice(Itr) = Tau;
-      Rho_Pst.slice(Itr) = Rho;
-      Sigma_Pst.slice(Itr) = 1 / Sigma_Inv.t();
-      LL_Pst(Itr) = LL_Star(A, S_YY, Sigma_Inv, p, n);
+      }
 
-      // Increase Itr by 1
-      Itr = Itr + 1;
+      A_Pseudo(i, j) = a + x;
 
     }
 
+    Change_A<Has_X>(i, j, x, Sigma_Inv);
 
   }
 
-  // Calculate estimates based on posterior samples
-  arma::mat A_Est = mean(A_Pst, 2);
-  arma::mat Gamma_Est = mean(Gamma_Pst, 2);
-  arma::mat Tau_Est = mean(Tau_Pst, 2);
-  arma::mat Rho_Est = mean(Rho_Pst, 2);
-  arma::mat Sigma_Est = mean(Sigma_Pst, 2);
 
-  // Construct the graph structures
-  arma::umat logicalGraph_A = (Gamma_Est > 0.5);
-  arma::mat zA_Est = arma::conv_to<arma::mat>::from(logicalGraph_A);
+  // Set entry (i, j) of B to the value that maximizes Target_B given everything else, where d is the precision of its prior
+  // The target is quadratic in the change x of the entry, - q x^2 / 2 - h x up to a constant, so a maximum that is not above tB
+  // is moved to the nearest value above tB
+  template <bool Thresholded>
+  void Maximize_B(int i, int j, const arma::colvec& Sigma_Inv, double d, double tB) {
 
-  // Return outputs
-  return Rcpp::List::create(Rcpp::Named("A_Est") = A_Est,
-                            Rcpp::Named("zA_Est") = zA_Est,
-                            Rcpp::Named("Gamma_Est") = Gamma_Est, Rcpp::Named("Tau_Est") = Tau_Est,
-                            Rcpp::Named("Rho_Est") = Rho_Est,
-                            Rcpp::Named("Sigma_Est") = Sigma_Est,
-                            Rcpp::Named("AccptA") = AccptA / (p * (p - 1) * nIter) * 100,
-                            Rcpp::Named("LL_Pst") = LL_Pst, Rcpp::Named("Gamma_Pst") = Gamma_Pst);
+    // Calculate coefficients of the target in x
+    double b = B(i, j);
+    double s = N * Sigma_Inv(i);
+    double Residual = S_YX(i, j) - arma::dot(A.row(i), S_YX.col(j)) - (Dot_B(i, S_XX.col(j)) + Dot_B(i, S_XX.row(j))) / 2;
+    double q = s * S_XX(j, j) + d;
+    double h = - s * Residual + d * b;
 
+    double x = - h / q;
 
-}
+    // Move the entry just above the threshold on its side if it is not above it, and keep it only if it beats 0
+    if (Thresholded) {
 
+      if (fabs(b + x) <= tB) {
 
+        double Edge = std::nextafter(tB, arma::datum::inf);
 
+        x = (b + x < 0 ? - Edge : Edge) - b;
 
+      }
 
-// Define the function NetworkMotif_cpp with two parameters: Gamma and Gamma_Pst
-// The function calculates the network motif based on the given parameters
-// [[Rcpp::export]]
-double NetworkMotif_cpp(const arma::mat& Gamma, const arma::cube& Gamma_Pst) {
+      if (- q * x * x / 2 - h * x < - q * b * b / 2 + h * b) {
 
-  // Calculate the number of posterior samples
-  double nPst = Gamma_Pst.n_slices;
+        x = - b;
 
-  // Initialize Count to keep track of matching network motifs
-  double Count = 0;
+      }
 
-  // Loop through each posterior sample
-  for (int i = 0; i < nPst; i++) {
+      B_Pseudo(i, j) = b + x;
 
-    // Extract the Gamma matrix for the current posterior sample
-    arma::mat Gamma_Test = Gamma_Pst.slice(i);
+    }
 
-    // Find indices where Gamma is equal to 1
-    arma::uvec indices = arma::find(Gamma == 1);
+    if (x == 0) {
 
-    // Calculate the absolute difference between the Gamma matrix and the Gamma_Test matrix where Gamma values are 1
-    double Diff = arma::accu(arma::abs(Gamma.elem(indices) - Gamma_Test.elem(indices)));
+      return;
 
-    // If the difference is zero, it means the network motif matches
-    if (Diff == 0) {
+    }
 
-      // Increment the count of matching network motifs
-      Count = Count + 1;
+    // Calculate changes in the row terms of row i
+    double DeltaC = x * S_YX(i, j);
+    double Delta6 = x * arma::dot(A.row(i), S_YX.col(j));
+    double Delta2 = x * (Dot_B(i, S_XX.col(j)) + Dot_B(i, S_XX.row(j)) + x * S_XX(j, j));
 
-    }
+    // Update B, row terms and trace values
+    B(i, j) += x;
+
+    C(i) += DeltaC;
+    R6(i) += Delta6;
+    R2(i) += Delta2;
+
+    Trace1 = Trace1 - 2 * s * (DeltaC - Delta6);
+    Trace2 = Trace2 + s * Delta2;
+    Trace6 = Trace6 + 2 * s * Delta6;
 
   }
 
-  // Return the proportion of matching network motifs to the total number of posterior samples
-  return (Count / nPst);
+};
+
+
+// Calculate log-likelihood for the model when only Y is there
+// [[Rcpp::export]]
+double LL_Star(const arma::mat& A, const arma::mat& S_YY, const arma::colvec& Sigma_Inv, double p, double N) {
+
+  // Calculate (I_p - A)
+  const arma::mat& Mult_Mat = arma::eye(p, p) - A;
+
+  // Calculate Sum
+  double Sum = N * arma::trace(S_YY * Mult_Mat.t() * arma::diagmat(Sigma_Inv) * Mult_Mat);
+
+  // Calculate log-likelihood
+  double LL = N * real(arma::log_det(Mult_Mat)) - N / 2 * accu(log(1/Sigma_Inv)) - Sum / 2 - N / 2 * log(2 * arma::datum::pi);
+
+  // Return log-likelihood
+  return LL;
+
+}
+
+
+
+
+// Sample random number from truncated normal
+double Sample_tn(RGM_RNG& RNG, double mu, double sigma, double a, double b) {
+
+  // Sample from truncated normal with mean mu and sd sigma
+  return RNG.Truncated_Normal(mu, sigma, a, b);
+
+}
+
+
+// Pdf of truncated normal distribution
+// [[Rcpp::export]]
+double tn_pdf(double x, double mu, double sigma, double a, double b) {
+
+  // Calculate alpha and beta
+  double alpha = (a - mu) / sigma;
+  double beta = (b - mu) / sigma;
+
+  // Calculate density
+  double d = arma::normpdf(x, mu, sigma) / (arma::normcdf(beta, 0.0, 1.0) - arma::normcdf(alpha, 0.0, 1.0));
+
+  // Return d
+  return d;
+
+}
+
+
+// Calculate log-likelihood for the model when both X and Y are there
+// [[Rcpp::export]]
+double LL(const arma::mat& A, const arma::mat& B, const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, const arma::colvec& Sigma_Inv, double p, double N) {
+
+  // Calculate (I_p - A)
+  const arma::mat& Mult_Mat = arma::eye(p, p) - A;
+
+  // Calculate Sum
+  double Sum = N * arma::trace(S_YY * Mult_Mat.t() * arma::diagmat(Sigma_Inv) * Mult_Mat) - 2 * N * arma::trace(S_YX * B.t() * arma::diagmat(Sigma_Inv) * Mult_Mat)
+    + N * arma::trace(S_XX * B.t() * arma::diagmat(Sigma_Inv) * B);
+
+  // Calculate log-likelihood
+  double LL = N * real(arma::log_det(Mult_Mat)) - N / 2 * accu(log(1/Sigma_Inv)) - Sum / 2 - N / 2 * log(2 * arma::datum::pi);
+
+  // Return log-likelihood
+  return LL;
+
+}
+
+
+
+
+
+
+
+// R arrays that receive the stored posterior samples and log-likelihoods of all the chains
+// The arrays are allocated on the main thread before the chains start, and every chain writes its samples
+// straight into its own range of slices, so they are returned to R without a copy. The samples of chain c
+// are slices c * nPst to (c + 1) * nPst - 1 and its log-likelihoods are column c of LL_Pst
+struct RGM_Buffers {
+
+  // Names of the arrays whose full samples are kept, whether to pack indicators, number of posterior samples and chains
+  std::vector<std::string> Store_Pst;
+  bool Pack_Pst;
+  int nPst;
+  int nChains;
+
+  // Names, R arrays, first entries and number of entries per slice of the allocated arrays
+  std::vector<std::string> Names;
+  std::vector<Rcpp::NumericVector> Arrays;
+  std::vector<double*> Memory;
+  std::vector<arma::uword> Rows, Cols;
+
+  // Posterior log-likelihoods and their first entry
+  Rcpp::NumericMatrix LL_Pst;
+  double* LL_Memory;
+
+  // Initialize with the requested arrays, number of posterior samples and number of chains
+  RGM_Buffers(const std::vector<std::string>& Store_Pst, bool Pack_Pst, int nPst, int nChains) :
+    Store_Pst(Store_Pst), Pack_Pst(Pack_Pst), nPst(nPst), nChains(nChains), LL_Pst(nPst, nChains), LL_Memory(LL_Pst.begin()) {}
+
+  // Allocate the array of posterior samples of Name with dimension Rows * Cols if it is requested and not packed
+  void Allocate(const std::string& Name, arma::uword n_rows, arma::uword n_cols) {
+
+    if (std::find(Store_Pst.begin(), Store_Pst.end(), Name + "_Pst") == Store_Pst.end() || (Pack_Pst && (Name == "Gamma" || Name == "Phi"))) {
+
+      return;
+
+    }
+
+    Rcpp::NumericVector Array(n_rows * n_cols * nPst * nChains);
+    Array.attr("dim") = Rcpp::IntegerVector::create(n_rows, n_cols, nPst * nChains);
+
+    Names.push_back(Name);
+    Arrays.push_back(Array);
+    Memory.push_back(Array.begin());
+    Rows.push_back(n_rows);
+    Cols.push_back(n_cols);
+
+  }
+
+  // Return the first entry of the samples of Name for chain c, or a null pointer if Name is not allocated
+  double* Samples(const std::string& Name, int c) const {
+
+    size_t m = std::find(Names.begin(), Names.end(), Name) - Names.begin();
+
+    if (m == Names.size()) {
+
+      return nullptr;
+
+    }
+
+    return Memory[m] + (size_t) c * nPst * Rows[m] * Cols[m];
+
+  }
+
+  // Return the array of Name with the first nUsed samples of every chain
+  // Without early stopping all the samples are used and the R array is returned without a copy
+  Rcpp::NumericVector Array(const std::string& Name, int nUsed) const {
+
+    size_t m = std::find(Names.begin(), Names.end(), Name) - Names.begin();
+
+    if (nUsed == nPst) {
+
+      return Arrays[m];
+
+    }
+
+    // Copy the used slices of every chain
+    size_t n_elem = Rows[m] * Cols[m];
+    Rcpp::NumericVector Used(n_elem * nUsed * nChains);
+
+    for (int c = 0; c < nChains; c++) {
+
+      std::copy(Memory[m] + c * nPst * n_elem, Memory[m] + (c * nPst + nUsed) * n_elem, Used.begin() + c * nUsed * n_elem);
+
+    }
+
+    Used.attr("dim") = Rcpp::IntegerVector::create(Rows[m], Cols[m], nUsed * nChains);
+
+    return Used;
+
+  }
+
+  // Return the log-likelihoods of the first nUsed samples of every chain
+  Rcpp::NumericMatrix LL_Array(int nUsed) const {
+
+    if (nUsed == nPst) {
+
+      return LL_Pst;
+
+    }
+
+    Rcpp::NumericMatrix Used(nUsed, nChains);
+
+    for (int c = 0; c < nChains; c++) {
+
+      std::copy(LL(c), LL(c) + nUsed, Used.begin() + c * nUsed);
+
+    }
+
+    return Used;
+
+  }
+
+  // Return the first log-likelihood of chain c
+  double* LL(int c) const {
+
+    return LL_Memory + (size_t) c * nPst;
+
+  }
+
+};
+
+
+// Posterior summaries of a single chain
+// Running sums of every array are updated as the samples arrive, so memory does not
+// grow with the number of posterior samples. Full samples are only kept for the arrays listed in Store_Pst,
+// the indicator arrays Gamma and Phi are packed into bits if Pack_Pst is true
+struct RGM_Posterior {
+
+  // Names of the arrays whose full samples are kept, whether to pack indicators and number of posterior samples
+  std::vector<std::string> Store_Pst;
+  bool Pack_Pst;
+  int nPst;
+
+  // Names and number of samples of the arrays
+  std::vector<std::string> Names;
+  std::vector<double> Count;
+
+  // Running sums
+  std::vector<arma::mat> Sum;
+
+  // R arrays of the full samples of this chain and packed full samples, null or empty unless requested
+  const RGM_Buffers& Buffers;
+  int Chain;
+  std::vector<double*> Samples;
+  std::vector<Packed_Array> Packed;
+
+  // Initialize with the buffers of the requested arrays and the chain number
+  RGM_Posterior(const RGM_Buffers& Buffers, int Chain) :
+    Store_Pst(Buffers.Store_Pst), Pack_Pst(Buffers.Pack_Pst), nPst(Buffers.nPst), Buffers(Buffers), Chain(Chain) {}
+
+  // Find index of array Name, returns the number of arrays if it is not there
+  size_t Find(const std::string& Name) const {
+
+    return std::find(Names.begin(), Names.end(), Name) - Names.begin();
+
+  }
+
+  // Add a posterior sample of array Name
+  void Add(const std::string& Name, const arma::mat& x) {
+
+    size_t m = Find(Name);
+
+    // Initialize the array at its first sample
+    if (m == Names.size()) {
+
+      Names.push_back(Name);
+      Count.push_back(0);
+      Sum.push_back(arma::zeros(x.n_rows, x.n_cols));
+      Samples.push_back(Buffers.Samples(Name, Chain));
+      Packed.push_back(Packed_Array());
+
+      if (Pack_Pst && (Name == "Gamma" || Name == "Phi") &&
+          std::find(Store_Pst.begin(), Store_Pst.end(), Name + "_Pst") != Store_Pst.end()) {
+
+        Packed[m] = Packed_Array(x.n_rows, x.n_cols, nPst);
+
+      }
+
+    }
+
+    // Store full sample through a view of the R array
+    if (Samples[m] != nullptr) {
+
+      arma::mat Slice(Samples[m] + (size_t) Count[m] * x.n_elem, x.n_rows, x.n_cols, false, true);
+      Slice = x;
+
+    } else if (Packed[m].n_slices > 0) {
+
+      Packed[m].Set_Slice(Count[m], x);
+
+    }
+
+    // Update running sum
+    Count[m] = Count[m] + 1;
+    Sum[m] += x;
+
+  }
+
+  // Add a posterior sample of scalar Name
+  void Add(const std::string& Name, double x) {
+
+    Add(Name, arma::mat(1, 1).fill(x));
+
+  }
+
+  // Save or restore the summaries and the samples stored so far
+  // Restored samples go to the start of the chain's range of the buffers, which may hold more samples than before
+  template <typename Archive>
+  void Serialize(Archive& Ar) {
+
+    Ar.Strings(Names);
+    Ar.Vector(Count);
+
+    size_t nArray = Names.size();
+
+    if (Ar.Reading) {
+
+      Sum.resize(nArray);
+      Samples.resize(nArray);
+      Packed.resize(nArray);
+
+    }
+
+    for (size_t m = 0; m < nArray; m++) {
+
+      Ar.Matrix(Sum[m]);
+
+      // Full samples in the R array
+      if (Ar.Reading) {
+
+        Samples[m] = Buffers.Samples(Names[m], Chain);
+
+      }
+
+      if (Samples[m] != nullptr) {
+
+        Ar.Bytes(Samples[m], (size_t) Count[m] * Sum[m].n_elem * sizeof(double));
+
+      }
+
+      // Packed full samples
+      bool Is_Packed = Packed[m].n_slices > 0;
+
+      Ar.Value(Is_Packed);
+
+      if (Is_Packed) {
+
+        Packed[m].Serialize(Ar, Count[m], nPst);
+
+      }
+
+    }
+
+  }
+
+  // Return posterior mean of array Name
+  // It is calculated from the running sum, so it equals the mean of the full samples
+  arma::mat Mean(const std::string& Name) const {
+
+    size_t m = Find(Name);
+
+    return Sum[m] / Count[m];
+
+  }
+
+};
+
+
+// Online batch means of the quantities monitored for convergence in a single chain
+// Every posterior sample is added to the batch in progress, and when Max_Batch batches are complete adjacent
+// batches are merged, which doubles the batch size. The number of complete batches therefore stays between
+// Max_Batch / 2 and Max_Batch, and memory does not grow with the number of samples. Continuous quantities keep
+// batch sums and sums of squares, indicators only keep batch counts as their squares equal themselves
+struct RGM_Monitor {
+
+  // Maximum number of complete batches
+  static const int Max_Batch = 32;
+
+  // Whether the quantities are monitored, number of continuous quantities and indicators
+  bool Enabled;
+  int nValue, nIndicator;
+
+  // Batch size, number of samples in the batch in progress and number of complete batches
+  int Batch_Size, In_Batch, nBatch;
+
+  // Batch sums and sums of squares of the continuous quantities and batch counts of the indicators
+  // Column nBatch holds the batch in progress
+  arma::mat Sum, Sum_Sq;
+  arma::fmat Count;
+
+  // Initialize without any samples, nothing is allocated unless Enabled
+  RGM_Monitor(bool Enabled, int nValue, int nIndicator) :
+    Enabled(Enabled), nValue(nValue), nIndicator(nIndicator), Batch_Size(1), In_Batch(0), nBatch(0) {
+
+    if (Enabled) {
+
+      Sum = arma::zeros(nValue, Max_Batch + 1);
+      Sum_Sq = arma::zeros(nValue, Max_Batch + 1);
+      Count = arma::zeros<arma::fmat>(nIndicator, Max_Batch + 1);
+
+    }
+
+  }
+
+  // Save or restore the batches
+  template <typename Archive>
+  void Serialize(Archive& Ar) {
+
+    Ar.Value(Batch_Size);
+    Ar.Value(In_Batch);
+    Ar.Value(nBatch);
+    Ar.Matrix(Sum);
+    Ar.Matrix(Sum_Sq);
+    Ar.Matrix(Count);
+
+  }
+
+  // Add a posterior sample with log-likelihood LL, monitored entries Values and indicators Indicator
+  void Add(double LL, const arma::colvec& Values, const arma::mat& Indicator) {
+
+    // Add continuous quantities
+    Sum(0, nBatch) += LL;
+    Sum_Sq(0, nBatch) += LL * LL;
+
+    for (int q = 1; q < nValue; q++) {
+
+      Sum(q, nBatch) += Values(q - 1);
+      Sum_Sq(q, nBatch) += Values(q - 1) * Values(q - 1);
+
+    }
+
+    // Add indicators
+    float* Batch_Count = Count.colptr(nBatch);
+    const double* z = Indicator.memptr();
+
+    for (int q = 0; q < nIndicator; q++) {
+
+      Batch_Count[q] += (float) z[q];
+
+    }
+
+    // Complete the batch
+    if (++In_Batch < Batch_Size) {
+
+      return;
+
+    }
+
+    In_Batch = 0;
+    nBatch++;
+
+    // Merge adjacent batches when all the batches are complete
+    if (nBatch == Max_Batch) {
+
+      for (int b = 0; b < Max_Batch / 2; b++) {
+
+        Sum.col(b) = Sum.col(2 * b) + Sum.col(2 * b + 1);
+        Sum_Sq.col(b) = Sum_Sq.col(2 * b) + Sum_Sq.col(2 * b + 1);
+        Count.col(b) = Count.col(2 * b) + Count.col(2 * b + 1);
+
+      }
+
+      Sum.cols(Max_Batch / 2, Max_Batch).zeros();
+      Sum_Sq.cols(Max_Batch / 2, Max_Batch).zeros();
+      Count.cols(Max_Batch / 2, Max_Batch).zeros();
+
+      nBatch = Max_Batch / 2;
+      Batch_Size *= 2;
+
+    }
+
+  }
+
+};
+
+
+// Split R-hat and effective sample size of a quantity from the batches of all the chains
+// Every chain is split into two halves of complete batches, dropping the first batch if their number is odd.
+// R-hat compares the variance of the samples between and within the 2 * nChains halves. The effective sample
+// size is the number of samples times the ratio of the within chain variance of the samples to the batch means
+// estimate of their asymptotic variance. A quantity that is constant within every half has R-hat 1 and is fully
+// efficient unless the halves differ, in which case R-hat is infinite
+struct RGM_Diagnostic {
+
+  double Rhat, ESS;
+
+  RGM_Diagnostic(const std::vector<const RGM_Monitor*>& Monitors, bool Indicator, int q) {
+
+    // Calculate number of chains, batch size and number of batches of a half
+    int nChains = Monitors.size();
+    int nBatch = Monitors[0]->nBatch;
+    int First = nBatch % 2;
+    int Half = nBatch / 2;
+    double Size = Monitors[0]->Batch_Size;
+
+    // Calculate means and variances of the samples of the halves and of the chains
+    double nHalf = Half * Size;
+    arma::colvec Half_Mean(2 * nChains), Half_Var(2 * nChains);
+    double Var_Samples = 0, Var_Batch = 0;
+
+    for (int c = 0; c < nChains; c++) {
+
+      const RGM_Monitor& Monitor = *Monitors[c];
+      arma::rowvec Batch_Sum = Indicator ? arma::conv_to<arma::rowvec>::from(Monitor.Count.row(q)) : arma::rowvec(Monitor.Sum.row(q));
+      arma::rowvec Batch_Sum_Sq = Indicator ? Batch_Sum : arma::rowvec(Monitor.Sum_Sq.row(q));
+
+      arma::rowvec Batch_Mean = Batch_Sum.subvec(First, nBatch - 1) / Size;
+
+      for (int h = 0; h < 2; h++) {
+
+        double Half_Sum = arma::accu(Batch_Sum.subvec(First + h * Half, First + (h + 1) * Half - 1));
+        double Half_Sum_Sq = arma::accu(Batch_Sum_Sq.subvec(First + h * Half, First + (h + 1) * Half - 1));
+
+        Half_Mean(2 * c + h) = Half_Sum / nHalf;
+        Half_Var(2 * c + h) = std::max(Half_Sum_Sq - nHalf * Half_Mean(2 * c + h) * Half_Mean(2 * c + h), 0.0) / (nHalf - 1);
+
+      }
+
+      // Calculate variance of the samples and batch means estimate of their asymptotic variance
+      double nSample = 2 * Half * Size;
+      double Mean = arma::accu(Batch_Sum.subvec(First, nBatch - 1)) / nSample;
+
+      Var_Samples += (arma::accu(Batch_Sum_Sq.subvec(First, nBatch - 1)) - nSample * Mean * Mean) / (nSample - 1);
+      Var_Batch += Size * arma::var(Batch_Mean);
+
+    }
+
+    // Calculate R-hat
+    double W = arma::mean(Half_Var);
+    double B = arma::var(Half_Mean);
+
+    if (W > 0) {
+
+      Rhat = std::sqrt(((nHalf - 1) / nHalf * W + B) / W);
+
+    } else {
+
+      Rhat = (B > 0) ? arma::datum::inf : 1;
+
+    }
+
+    // Calculate effective sample size
+    double nTotal = 2.0 * Half * Size * nChains;
+
+    ESS = (Var_Batch > 0) ? nTotal * std::max(Var_Samples, 0.0) / Var_Batch : nTotal;
+
+  }
+
+};
+
+
+// Convergence diagnostics of all the monitored quantities at the end of a segment of the chains
+// The quantities are the log-likelihood, the entries of A in Monitor_A and the indicators of Gamma.
+// The diagnostics are reported from 16 batches on, but as R-hat of halves of a few samples is too noisy
+// to stop on, the chains only count as converged once every chain has Min_Sample samples in its halves
+struct RGM_Convergence {
+
+  // Minimum number of posterior samples per chain before sampling can stop
+  static const int Min_Sample = 100;
+
+  // Diagnostics of the log-likelihood and the entries of A, and the worst diagnostics of the indicators
+  double Rhat_LL, ESS_LL, Rhat_Gamma, ESS_Gamma;
+  arma::colvec Rhat_A, ESS_A;
+
+  // Worst diagnostics over all the quantities
+  double Rhat_Max, ESS_Min;
+
+  // Whether there are enough batches to calculate the diagnostics and number of samples per chain they are based on
+  bool Available;
+  int nSample;
+
+  RGM_Convergence() : Rhat_LL(NA_REAL), ESS_LL(NA_REAL), Rhat_Gamma(NA_REAL), ESS_Gamma(NA_REAL), Rhat_Max(NA_REAL), ESS_Min(NA_REAL), Available(false), nSample(0) {}
+
+  // Calculate the diagnostics, with the indicators split across nThreads threads
+  RGM_Convergence(const std::vector<const RGM_Monitor*>& Monitors, int nThreads) : RGM_Convergence() {
+
+    const RGM_Monitor& First = *Monitors[0];
+
+    // Split halves need at least 8 batches each
+    if (First.nBatch < RGM_Monitor::Max_Batch / 2) {
+
+      return;
+
+    }
+
+    Available = true;
+    nSample = First.nBatch / 2 * 2 * First.Batch_Size;
+
+    // Diagnose the log-likelihood and the entries of A
+    RGM_Diagnostic LL(Monitors, false, 0);
+
+    Rhat_LL = LL.Rhat;
+    ESS_LL = LL.ESS;
+    Rhat_A.set_size(First.nValue - 1);
+    ESS_A.set_size(First.nValue - 1);
+
+    for (int q = 1; q < First.nValue; q++) {
+
+      RGM_Diagnostic Entry(Monitors, false, q);
+
+      Rhat_A(q - 1) = Entry.Rhat;
+      ESS_A(q - 1) = Entry.ESS;
+
+    }
+
+    // Diagnose the indicators in parallel
+    int nIndicator = First.nIndicator;
+    arma::colvec Rhat_Z(nIndicator), ESS_Z(nIndicator);
+
+#pragma omp parallel for num_threads(nThreads) schedule(static)
+    for (int q = 0; q < nIndicator; q++) {
+
+      RGM_Diagnostic Entry(Monitors, true, q);
+
+      Rhat_Z(q) = Entry.Rhat;
+      ESS_Z(q) = Entry.ESS;
+
+    }
+
+    Rhat_Gamma = nIndicator > 0 ? Rhat_Z.max() : 1;
+    ESS_Gamma = nIndicator > 0 ? ESS_Z.min() : arma::datum::inf;
+
+    // Find the worst diagnostics
+    Rhat_Max = std::max(Rhat_LL, Rhat_Gamma);
+    ESS_Min = std::min(ESS_LL, ESS_Gamma);
+
+    if (Rhat_A.n_elem > 0) {
+
+      Rhat_Max = std::max(Rhat_Max, Rhat_A.max());
+      ESS_Min = std::min(ESS_Min, ESS_A.min());
+
+    }
+
+  }
+
+  // Return whether the thresholds are met after at least Min_Sample samples per chain, a threshold of 0 is not checked
+  bool Converged(double Stop_Rhat, double Stop_ESS) const {
+
+    return Available && nSample >= Min_Sample && (Stop_Rhat <= 0 || Rhat_Max <= Stop_Rhat) && (Stop_ESS <= 0 || ESS_Min >= Stop_ESS);
+
+  }
+
+  // Convert to an R list with the reason sampling stopped and the number of iterations run
+  Rcpp::List Wrap(const std::string& Stop_Reason, int nIter) const {
+
+    return Rcpp::List::create(Rcpp::Named("Stop_Reason") = Stop_Reason, Rcpp::Named("nIter") = nIter,
+                              Rcpp::Named("Rhat_Max") = Rhat_Max, Rcpp::Named("ESS_Min") = ESS_Min,
+                              Rcpp::Named("Rhat_LL") = Rhat_LL, Rcpp::Named("ESS_LL") = ESS_LL,
+                              Rcpp::Named("Rhat_Gamma") = Rhat_Gamma, Rcpp::Named("ESS_Gamma") = ESS_Gamma,
+                              Rcpp::Named("Rhat_A") = Rcpp::NumericVector(Rhat_A.begin(), Rhat_A.end()),
+                              Rcpp::Named("ESS_A") = Rcpp::NumericVector(ESS_A.begin(), ESS_A.end()));
+
+  }
+
+};
+
+
+// Outputs of a single chain
+// Estimates and acceptance rates are stored by name, scalars as 1 x 1 matrices
+struct RGM_Chain {
+
+  // Names, values and scalar flags of the outputs
+  std::vector<std::string> Names;
+  std::vector<arma::mat> Values;
+  std::vector<bool> Scalar;
+
+  // Names and packed values of the stored posterior samples, unpacked values are already in RGM_Buffers
+  std::vector<std::string> Pst_Names;
+  std::vector<Packed_Array> Pst_Packed;
+
+  // Add a matrix output
+  void Add(const std::string& Name, const arma::mat& Value) {
+
+    Names.push_back(Name);
+    Values.push_back(Value);
+    Scalar.push_back(false);
+
+  }
+
+  // Add a scalar output
+  void Add(const std::string& Name, double Value) {
+
+    Names.push_back(Name);
+    Values.push_back(arma::mat(1, 1).fill(Value));
+    Scalar.push_back(true);
+
+  }
+
+  // Add the stored posterior samples in the order they were requested
+  void Add_Samples(RGM_Posterior& Pst) {
+
+    for (size_t r = 0; r < Pst.Store_Pst.size(); r++) {
+
+      for (size_t m = 0; m < Pst.Names.size(); m++) {
+
+        if (Pst.Names[m] + "_Pst" == Pst.Store_Pst[r]) {
+
+          Pst_Names.push_back(Pst.Store_Pst[r]);
+          Pst_Packed.push_back(std::move(Pst.Packed[m]));
+
+        }
+
+      }
+
+    }
+
+  }
+
+};
+
+
+// Pool the outputs of all the chains
+// Estimates and acceptance rates are averaged over the chains, the graph structures are constructed
+// from the pooled probabilities and the first nUsed posterior samples of every chain are returned
+Rcpp::List Pool_Chains(std::vector<RGM_Chain>& Chains, const RGM_Buffers& Buffers, int nUsed, const Rcpp::List& Convergence) {
+
+  // Calculate number of chains and number of outputs
+  int nChains = Chains.size();
+  int nOut = Chains[0].Names.size();
+
+  // Average the outputs over the chains
+  std::vector<arma::mat> Values = Chains[0].Values;
+
+  for (int m = 0; m < nOut; m++) {
+
+    for (int c = 1; c < nChains; c++) {
+
+      Values[m] += Chains[c].Values[m];
+
+    }
+
+    Values[m] /= nChains;
+
+  }
+
+  // Construct the graph structures from the pooled Gamma_Est and Phi_Est
+  for (int m = 0; m < nOut; m++) {
+
+    // Find the probabilities the graph structure is based on
+    std::string Prob = (Chains[0].Names[m] == "zA_Est") ? "Gamma_Est" : (Chains[0].Names[m] == "zB_Est") ? "Phi_Est" : "";
+
+    for (int l = 0; l < nOut; l++) {
+
+      if (!Prob.empty() && Chains[0].Names[l] == Prob) {
+
+        Values[m] = arma::conv_to<arma::mat>::from(Values[l] > 0.5);
+
+      }
+
+    }
+
+  }
+
+  // Calculate number of stored posterior arrays
+  int nStore = Chains[0].Pst_Names.size();
+
+  // Create output list
+  Rcpp::List Output(nOut + 2 + nStore);
+  Rcpp::CharacterVector Names(nOut + 2 + nStore);
+
+  for (int m = 0; m < nOut; m++) {
+
+    Names[m] = Chains[0].Names[m];
+
+    if (Chains[0].Scalar[m]) {
+
+      Output[m] = Values[m](0, 0);
+
+    } else {
+
+      Output[m] = Values[m];
+
+    }
+
+  }
+
+  // Add posterior log-likelihoods and stored posterior samples
+  Names[nOut] = "LL_Pst";
+
+  for (int m = 0; m < nStore; m++) {
+
+    Names[nOut + 1 + m] = Chains[0].Pst_Names[m];
+
+  }
+
+  // The log-likelihoods of chain c are in column c
+  Output[nOut] = Buffers.LL_Array(nUsed);
+
+  // The posterior samples are already stacked chain by chain, only packed samples are concatenated
+  for (int m = 0; m < nStore; m++) {
+
+    if (Chains[0].Pst_Packed[m].n_slices > 0) {
+
+      std::vector<const Packed_Array*> Packed;
+
+      for (int c = 0; c < nChains; c++) {
+
+        Chains[c].Pst_Packed[m].Truncate(nUsed);
+        Packed.push_back(&Chains[c].Pst_Packed[m]);
+
+      }
+
+      Output[nOut + 1 + m] = Wrap_Packed(Packed);
+
+    } else {
+
+      std::string Name = Chains[0].Pst_Names[m];
+
+      Output[nOut + 1 + m] = Buffers.Array(Name.substr(0, Name.size() - 4), nUsed);
+
+    }
+
+  }
+
+  // Add convergence diagnostics
+  Names[nOut + 1 + nStore] = "Convergence";
+  Output[nOut + 1 + nStore] = Convergence;
+
+  Output.attr("names") = Names;
+
+  // Return output list
+  return Output;
+
+}
+
+
+// Prior policies of the sampler
+// With the threshold prior A and B are A_Pseudo and B_Pseudo thresholded at tA and tB, which are sampled as well.
+// With the spike and slab prior the indicators Gamma and Phi are sampled with their probabilities Rho and Psi
+struct Threshold_Prior {
+
+  static const bool Thresholded = true;
+
+};
+
+struct SpikeSlab_Prior {
+
+  static const bool Thresholded = false;
+
+};
+
+
+// Model policies of the sampler
+// Without X there is no B, and S_YX, S_XX and D have no columns
+struct Y_Model {
+
+  static const bool Has_X = false;
+
+};
+
+struct XY_Model {
+
+  static const bool Has_X = true;
+
+};
+
+
+// Settings of the sampler, parameters a prior does not use are ignored
+// The exports set the fields by name, so a field they do not set keeps its default below
+struct RGM_Settings {
+
+  // Number of iterations, burn-in and thinning
+  int nIter = 1, nBurnin = 0, Thin = 1;
+
+  // Hyperparameters
+  double a_rho = 0, b_rho = 0, nu_1 = 0, a_psi = 0, b_psi = 0, nu_2 = 0, a_sigma = 0, b_sigma = 0;
+
+  // Proposal variances and number of iterations between full recalculations of the sampler state
+  double Prop_VarA = 0, Prop_VarB = 0;
+  int nRefresh = 1;
+
+  // Whether the reciprocal entries (i, j) and (j, i) of A are proposed jointly
+  bool Pair_A = false;
+
+  // Whether the proposal variances of the entries of A and B are adapted during burn-in
+  bool Adapt_Prop = false;
+
+  // Thresholds of R-hat and effective sample size to stop sampling, 0 if not checked, and iterations between checks
+  double Stop_Rhat = 0, Stop_ESS = 0;
+  int Check_Every = 1;
+
+  // Column major indices of the entries of A monitored for convergence
+  std::vector<arma::uword> Monitor_A;
+
+  // Path of the checkpoint file, empty if no checkpoints are saved, and iterations between checkpoints
+  std::string Checkpoint_File;
+  int Checkpoint_Every = 1;
+
+  // Whether the chains start at the posterior mode, and maximum number of sweeps and tolerance of the mode search
+  bool Init_MAP = false;
+  int MAP_Iter = 100;
+  double MAP_Tol = 1e-6;
+
+  // Column major indices of the candidate entries of A, empty if every off-diagonal entry is a candidate
+  // Entries of A that are not candidates are not sampled and stay 0
+  std::vector<arma::uword> Candidate_A;
+
+  // Whether I - A is kept as a sparse LU factorization instead of a dense inverse
+  bool Sparse_A = false;
+
+  // Number of threads that evaluate the proposals of a row of A, or sweep the rows of B, within each chain
+  int Chain_Threads = 1;
+
+  // Whether the rows of B are swept in parallel with a random number stream for each row
+  bool Parallel_B = false;
+
+  // Return number of posterior samples, the iterations after burn-in that are multiples of Thin
+  int nPst() const {
+
+    return nIter / Thin - nBurnin / Thin;
+
+  }
+
+  // Save or restore the settings
+  template <typename Archive>
+  void Serialize(Archive& Ar) {
+
+    Ar.Value(nIter);
+    Ar.Value(nBurnin);
+    Ar.Value(Thin);
+    Ar.Value(a_rho);
+    Ar.Value(b_rho);
+    Ar.Value(nu_1);
+    Ar.Value(a_psi);
+    Ar.Value(b_psi);
+    Ar.Value(nu_2);
+    Ar.Value(a_sigma);
+    Ar.Value(b_sigma);
+    Ar.Value(Prop_VarA);
+    Ar.Value(Prop_VarB);
+    Ar.Value(nRefresh);
+    Ar.Value(Pair_A);
+    Ar.Value(Adapt_Prop);
+    Ar.Value(Stop_Rhat);
+    Ar.Value(Stop_ESS);
+    Ar.Value(Check_Every);
+    Ar.Vector(Monitor_A);
+    Ar.String(Checkpoint_File);
+    Ar.Value(Checkpoint_Every);
+    Ar.Value(Init_MAP);
+    Ar.Value(MAP_Iter);
+    Ar.Value(MAP_Tol);
+    Ar.Vector(Candidate_A);
+    Ar.Value(Sparse_A);
+    Ar.Value(Chain_Threads);
+    Ar.Value(Parallel_B);
+
+  }
+
+};
+
+
+// Return the mask of the candidate entries of A, every off-diagonal entry if Candidate_A is empty
+inline arma::mat Candidate_Mask(int p, const std::vector<arma::uword>& Candidate_A) {
+
+  arma::mat Mask = Candidate_A.empty() ? arma::ones(p, p) : arma::zeros(p, p);
+
+  for (size_t m = 0; m < Candidate_A.size(); m++) {
+
+    Mask(Candidate_A[m]) = 1;
+
+  }
+
+  Mask.diag().zeros();
+
+  return Mask;
+
+}
+
+
+// Contents of a checkpoint besides the chains
+// The data are part of the checkpoint, so a run can be resumed from the file alone
+struct RGM_Checkpoint {
+
+  // Prior and model of the sampler
+  bool Thresholded, Has_X;
+
+  // Settings, summary level data and number of datapoints
+  RGM_Settings Settings;
+  arma::mat S_YY, S_YX, S_XX, D;
+  double n;
+
+  // Number of chains, iterations run and the reason sampling stopped
+  int nChains, Done;
+  std::string Stop_Reason;
+
+  // Names of the arrays whose full samples are kept and whether to pack indicators
+  std::vector<std::string> Store_Pst;
+  bool Pack_Pst;
+
+  // Save or restore the contents
+  template <typename Archive>
+  void Serialize(Archive& Ar) {
+
+    Ar.Value(Thresholded);
+    Ar.Value(Has_X);
+    Settings.Serialize(Ar);
+    Ar.Matrix(S_YY);
+    Ar.Matrix(S_YX);
+    Ar.Matrix(S_XX);
+    Ar.Matrix(D);
+    Ar.Value(n);
+    Ar.Value(nChains);
+    Ar.Value(Done);
+    Ar.String(Stop_Reason);
+    Ar.Strings(Store_Pst);
+    Ar.Value(Pack_Pst);
+
+  }
+
+};
+
+
+// Save a checkpoint of all the chains to the checkpoint file of the settings
+template <typename Chain_Type>
+void Save_Checkpoint(std::vector<Chain_Type>& Chains, const RGM_Buffers& Buffers, const RGM_Settings& Settings, const std::string& Stop_Reason) {
+
+  const Chain_Type& First = Chains[0];
+
+  RGM_Checkpoint Header = {Chain_Type::Thr, Chain_Type::X, Settings, First.State.S_YY, First.State.S_YX, First.State.S_XX, First.D, First.n,
+                           (int) Chains.size(), First.Iter, Stop_Reason, Buffers.Store_Pst, Buffers.Pack_Pst};
+
+  Checkpoint_Archive Ar(Settings.Checkpoint_File, false);
+
+  Header.Serialize(Ar);
+
+  for (size_t c = 0; c < Chains.size(); c++) {
+
+    Chains[c].Serialize(Ar);
+
+  }
+
+  Ar.Commit();
+
+}
+
+
+// Return the first iteration after Done that is Start plus a positive multiple of Every
+inline int Next_Boundary(int Done, int Start, int Every) {
+
+  return Start + std::max(1, (Done - Start) / Every + 1) * Every;
+
+}
+
+
+// Run the chains on separate threads from the iteration they are at and pool their outputs
+// Without a convergence threshold or checkpoints every chain runs up to nIter at once. Otherwise the chains run in
+// segments that end every Check_Every iterations after burn-in and every Checkpoint_Every iterations. At the
+// end of a segment the convergence diagnostics of all the chains are calculated and the checkpoint is saved on
+// the main thread. Sampling stops at the end of the first check that meets the thresholds, so every chain keeps
+// the same number of posterior samples regardless of the number of threads. The segments end at fixed iterations
+// and the chains keep their whole state between them, so a resumed run continues exactly as the original would
+template <typename Chain_Type>
+Rcpp::List Run_Chains(std::vector<Chain_Type>& Chains, const RGM_Buffers& Buffers, const RGM_Settings& Settings, std::string Stop_Reason = "nIter") {
+
+  // Calculate number of chains and threads
+  int nChains = Chains.size();
+  int nThreads = 1;
+
+#ifdef _OPENMP
+  nThreads = std::min(nChains, omp_get_max_threads());
+#endif
+
+  // Initialize error messages of the chains
+  std::vector<std::string> Errors(nChains);
+
+  // Initialize iterations run, monitored quantities and diagnostics
+  bool Monitor = Settings.Stop_Rhat > 0 || Settings.Stop_ESS > 0;
+  bool Save = !Settings.Checkpoint_File.empty();
+  int Done = Chains[0].Iter;
+  RGM_Convergence Convergence;
+  bool Checked = false;
+
+  std::vector<const RGM_Monitor*> Monitors;
+
+  for (int c = 0; c < nChains; c++) {
+
+    Monitors.push_back(&Chains[c].Monitor);
+
+  }
+
+  while (Done < Settings.nIter && Stop_Reason != "Converged") {
+
+    // Calculate the last iteration of the segment
+    int Until = Settings.nIter;
+
+    if (Monitor) {
+
+      Until = std::min(Until, Next_Boundary(Done, Settings.nBurnin, Settings.Check_Every));
+
+    }
+
+    if (Save) {
+
+      Until = std::min(Until, Next_Boundary(Done, 0, Settings.Checkpoint_Every));
+
+    }
+
+    // Run the chains, allowing the threads of each chain to nest inside the threads of the chains
+#ifdef _OPENMP
+    int Levels = omp_get_max_active_levels();
+
+    if (Settings.Chain_Threads > 1) {
+
+      omp_set_max_active_levels(std::max(Levels, 2));
+
+    }
+#endif
+
+#pragma omp parallel for num_threads(nThreads) schedule(dynamic, 1)
+    for (int c = 0; c < nChains; c++) {
+
+      // Exceptions must not escape the parallel region
+      try {
+
+        Chains[c].Run(Until);
+
+      } catch (std::exception& e) {
+
+        Errors[c] = e.what();
+
+      }
+
+    }
+
+#ifdef _OPENMP
+    omp_set_max_active_levels(Levels);
+#endif
+
+    // Report errors on the main thread
+    for (int c = 0; c < nChains; c++) {
+
+      if (!Errors[c].empty()) {
+
+        Rcpp::stop(Errors[c]);
+
+      }
+
+    }
+
+    Done = Until;
+
+    // Check convergence every Check_Every iterations after burn-in and at the last iteration
+    if (Monitor && Done > Settings.nBurnin && ((Done - Settings.nBurnin) % Settings.Check_Every == 0 || Done == Settings.nIter)) {
+
+      Convergence = RGM_Convergence(Monitors, nThreads);
+      Checked = true;
+
+      if (Convergence.Converged(Settings.Stop_Rhat, Settings.Stop_ESS)) {
+
+        Stop_Reason = "Converged";
+
+      }
+
+    }
+
+    // Save the checkpoint every Checkpoint_Every iterations and when sampling stops
+    if (Save && (Done % Settings.Checkpoint_Every == 0 || Done == Settings.nIter || Stop_Reason == "Converged")) {
+
+      Save_Checkpoint(Chains, Buffers, Settings, Stop_Reason);
+
+    }
+
+    // Allow the user to interrupt between segments
+    if (Done < Settings.nIter && Stop_Reason != "Converged") {
+
+      Rcpp::checkUserInterrupt();
+
+    }
+
+  }
+
+  // Calculate the diagnostics of a resumed run that had already stopped
+  if (Monitor && Done > Settings.nBurnin && !Checked) {
+
+    Convergence = RGM_Convergence(Monitors, nThreads);
+
+  }
+
+  // Collect outputs of the chains
+  std::vector<RGM_Chain> Outputs;
+
+  for (int c = 0; c < nChains; c++) {
+
+    Outputs.push_back(Chains[c].Output());
+
+  }
+
+  // Return pooled outputs
+  return Pool_Chains(Outputs, Buffers, Chains[0].Itr, Convergence.Wrap(Stop_Reason, Done));
+
+}
+
+
+// Allocate the R arrays of the posterior samples of the arrays a sampler stores
+template <typename Prior, typename Model>
+void Allocate_Buffers(RGM_Buffers& Buffers, int p, int k) {
+
+  const bool Thr = Prior::Thresholded, X = Model::Has_X;
+
+  Buffers.Allocate("A", p, p);
+  if (Thr) Buffers.Allocate("A0", p, p);
+  if (X) Buffers.Allocate("B", p, k);
+  if (Thr && X) Buffers.Allocate("B0", p, k);
+  Buffers.Allocate("Gamma", p, p);
+  Buffers.Allocate("Tau", p, p);
+  if (!Thr) Buffers.Allocate("Rho", p, p);
+  if (X) Buffers.Allocate("Phi", p, k);
+  if (X) Buffers.Allocate("Eta", p, k);
+  if (!Thr && X) Buffers.Allocate("Psi", p, k);
+  if (Thr) Buffers.Allocate("tA", 1, 1);
+  if (Thr && X) Buffers.Allocate("tB", 1, 1);
+  Buffers.Allocate("Sigma", 1, p);
+
+}
+
+
+// Posterior mode found by coordinate ascent
+// Gamma and Phi are the inclusion probabilities of the entries at the mode with the spike and slab prior and the
+// indicators of the thresholded entries with the threshold prior
+struct RGM_Mode {
+
+  // A, B, their pseudo versions, Sigma_Inv, inclusion probabilities and thresholds
+  arma::mat A, A_Pseudo, B, B_Pseudo;
+  arma::colvec Sigma_Inv;
+  arma::mat Gamma, Phi;
+  double tA, tB;
+
+  // Log-likelihood at the mode, number of sweeps run and whether the changes fell below the tolerance
+  double LL;
+  int nSweep;
+  bool Converged;
+
+};
+
+
+// Move the threshold of A or B to the point of a grid over (0, t0) with the largest log-likelihood
+// Thresholds only change the likelihood, so this maximizes the target over the threshold on the grid. The grid is
+// walked upward with the threshold moves of the sampler, so every step only touches the entries it changes
+inline double Maximize_Threshold(RGM_State& State, const arma::colvec& Sigma_Inv, bool For_A, double t, double t0) {
+
+  const int nGrid = 100;
+
+  // Walk the grid and keep the best threshold, the gains are relative to t
+  double Best = t, Gain = 0, Best_Gain = 0;
+
+  for (int g = 1; g < nGrid; g++) {
+
+    double t_new = t0 * g / nGrid;
+
+    Gain += For_A ? State.Propose_Threshold_A(t_new, Sigma_Inv) : State.Propose_Threshold_B(t_new, Sigma_Inv);
+    State.Accept_Threshold();
+
+    if (Gain > Best_Gain) {
+
+      Best = t_new;
+      Best_Gain = Gain;
+
+    }
+
+  }
+
+  // Move to the best threshold
+  For_A ? State.Propose_Threshold_A(Best, Sigma_Inv) : State.Propose_Threshold_B(Best, Sigma_Inv);
+  State.Accept_Threshold();
+
+  return Best;
+
+}
+
+
+// Find the posterior mode of A, B and Sigma by coordinate ascent on the target of the sampler
+// Every sweep updates B, Sigma and A in the order of the sampler, setting every entry to the maximizer of its
+// Target_A or Target_B and every Sigma to the mode of its inverse gamma conditional. The local scales Tau and Eta
+// are fixed at 1, the scale of their prior, as their joint mode with an entry at 0 is degenerate. With the spike
+// and slab prior the indicators are integrated out by EM: after every sweep Gamma and Phi are replaced by their
+// inclusion probabilities given the entries, which set the prior precisions of the next sweep, and Rho and Psi by
+// their conditional means. The first sweep uses the slab for every entry, so the search does not start with every
+// entry shrunk to 0 by the spike. With the threshold prior the thresholds are maximized on a grid after every sweep.
+// The search stops when no entry of A or B changes by more than MAP_Tol in a sweep, or after MAP_Iter sweeps
+template <typename Prior, typename Model>
+RGM_Mode Find_Mode(const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, const arma::mat& D, double n, const RGM_Settings& Settings) {
+
+  const bool Thr = Prior::Thresholded, X = Model::Has_X;
+
+  int p = S_YY.n_cols, k = S_XX.n_cols;
+  double nu_1 = Settings.nu_1, nu_2 = Settings.nu_2;
+
+  // Initialize the state with zero A and B and its restricted support of B
+  RGM_State State(S_YY, S_YX, S_XX, n, Settings.Sparse_A);
+
+  if (X) {
+
+    State.Set_Support(D);
+
+  }
+
+  // Initialize Sigma_Inv at its mode given A and B
+  arma::colvec Sigma_Inv(p);
+
+  for (int j = 0; j < p; j++) {
+
+    Sigma_Inv(j) = (n / 2 + Settings.a_sigma + 1) / (n * S_YY(j, j) / 2 + Settings.b_sigma);
+
+  }
+
+  // Initialize inclusion probabilities with the slab on the candidate entries and probabilities with their prior means
+  arma::mat A_Mask = Candidate_Mask(p, Settings.Candidate_A);
+  std::vector<std::vector<arma::uword> > A_Support = Mask_Support(A_Mask);
+
+  arma::mat B_Mask = X ? arma::conv_to<arma::mat>::from(D != 0) : arma::zeros(p, 0);
+
+  RGM_Mode Mode;
+
+  Mode.Gamma = A_Mask;
+  Mode.Phi = B_Mask;
+  Mode.tA = 0;
+  Mode.tB = 0;
+  Mode.nSweep = 0;
+  Mode.Converged = false;
+
+  arma::mat Rho = arma::ones(p, p) * Settings.a_rho / (Settings.a_rho + Settings.b_rho);
+  arma::mat Psi = arma::ones(p, k) * Settings.a_psi / (Settings.a_psi + Settings.b_psi);
+
+  while (Mode.nSweep < Settings.MAP_Iter && !Mode.Converged) {
+
+    // Recalculate the state from scratch to remove the rounding error of the previous sweep
+    State.Refresh(Sigma_Inv);
+
+    arma::mat A_Old = State.A, B_Old = State.B;
+
+    // Update B
+    if (X) {
+
+      for (int j = 0; j < p; j++) {
+
+        for (size_t m = 0; m < State.Support[j].size(); m++) {
+
+          int l = State.Support[j][m];
+
+          State.Maximize_B<Thr>(j, l, Sigma_Inv, Mode.Phi(j, l) + (1 - Mode.Phi(j, l)) / nu_2, Mode.tB);
+
+        }
+
+      }
+
+      if (Thr) {
+
+        Mode.tB = Maximize_Threshold(State, Sigma_Inv, false, Mode.tB, 1);
+
+      }
+
+    }
+
+    // Update Sigma
+    for (int j = 0; j < p; j++) {
+
+      Sigma_Inv(j) = (n / 2 + Settings.a_sigma + 1) / (State.Row_Sum(j) / 2 + Settings.b_sigma);
+
+    }
+
+    State.Rescale(Sigma_Inv);
+
+    // Update the candidate entries of A
+    for (int j = 0; j < p; j++) {
+
+      for (size_t m = 0; m < A_Support[j].size(); m++) {
+
+        int l = A_Support[j][m];
+
+        State.Maximize_A<Thr, X>(j, l, Sigma_Inv, Mode.Gamma(j, l) + (1 - Mode.Gamma(j, l)) / nu_1, Mode.tA);
+
+      }
+
+    }
+
+    if (Thr) {
+
+      Mode.tA = Maximize_Threshold(State, Sigma_Inv, true, Mode.tA, 1);
+
+    }
+
+    // Replace the indicators by their inclusion probabilities and the probabilities by their conditional means
+    if (!Thr) {
+
+      for (int l = 0; l < p * p; l++) {
+
+        double a = State.A(l);
+        double Slab = std::exp(-0.5 * a * a) * Rho(l);
+        double Spike = 1 / std::sqrt(nu_1) * std::exp(-0.5 * a * a / nu_1) * (1 - Rho(l));
+
+        Mode.Gamma(l) = A_Mask(l) * Slab / (Slab + Spike);
+        Rho(l) = (Mode.Gamma(l) + Settings.a_rho) / (1 + Settings.a_rho + Settings.b_rho);
+
+      }
+
+      for (int l = 0; l < p * k; l++) {
+
+        double b = State.B(l);
+        double Slab = std::exp(-0.5 * b * b) * Psi(l);
+        double Spike = 1 / std::sqrt(nu_2) * std::exp(-0.5 * b * b / nu_2) * (1 - Psi(l));
+
+        Mode.Phi(l) = B_Mask(l) * Slab / (Slab + Spike);
+        Psi(l) = (Mode.Phi(l) + Settings.a_psi) / (1 + Settings.a_psi + Settings.b_psi);
+
+      }
+
+    }
+
+    // Check the changes of the sweep
+    double Change = arma::abs(State.A - A_Old).max();
+
+    if (X) {
+
+      Change = std::max(Change, arma::abs(State.B - B_Old).max());
+
+    }
+
+    Mode.nSweep++;
+    Mode.Converged = Change <= Settings.MAP_Tol;
+
+  }
+
+  // Calculate the indicators of the threshold prior and the log-likelihood at the mode
+  if (Thr) {
+
+    Mode.Gamma = arma::conv_to<arma::mat>::from(State.A != 0);
+    Mode.Phi = arma::conv_to<arma::mat>::from(State.B != 0);
+
+  }
+
+  State.Refresh(Sigma_Inv);
+
+  Mode.A = State.A;
+  Mode.A_Pseudo = Thr ? State.A_Pseudo : State.A;
+  Mode.B = State.B;
+  Mode.B_Pseudo = Thr ? State.B_Pseudo : State.B;
+  Mode.Sigma_Inv = Sigma_Inv;
+  Mode.LL = State.Log_Likelihood(Sigma_Inv);
+
+  return Mode;
+
+}
+
+
+// Single chain of MCMC sampling
+// The prior and the model are compile time policies, so the branches of the other priors and models are removed
+// by the compiler and the arrays they use are never allocated. The chain keeps its whole state between calls of
+// Run, so all the chains can be run in segments with convergence checked between them
+template <typename Prior, typename Model>
+struct RGM_Sampler_Chain {
+
+  static const bool Thr = Prior::Thresholded, X = Model::Has_X;
+
+  // Summary level data, number of datapoints, settings and dimensions
+  const arma::mat& D;
+  double n;
+  RGM_Settings Settings;
+  int p, k;
+
+  // Random number generator of this chain
+  RGM_RNG RNG;
+
+  // Sampler state with A, B, A_Pseudo and B_Pseudo matrices, and Sigma_Inv
+  RGM_State State;
+  arma::colvec Sigma_Inv;
+
+  // Local scales, indicators and their probabilities
+  arma::mat Gamma, Tau, Rho, Psi, Phi, Eta;
+
+  // Masks of the entries of A and B that are sampled and the candidate columns of every row of A
+  arma::mat A_Mask, B_Mask;
+  std::vector<std::vector<arma::uword> > A_Support;
+
+  // Log proposal sds of the entries of A and B and target acceptance rates of single entry and pair proposals
+  arma::mat Log_SdA, Log_SdB;
+  double Target_Accpt, Target_Accpt_Pair;
+
+  // Observed rate of proposals that change A in the sweeps with Chain_Threads, which sizes their blocks but does not
+  // change the samples, so it is not saved in checkpoints
+  double Rate_A;
+
+  // Thresholds and their proposal parameters
+  double tA, tB, t0, t_sd;
+
+  // Acceptance counters
+  double AccptA, AccptB, Accpt_tA, Accpt_tB;
+
+  // Number of iterations run and number of posterior samples stored
+  int Iter, Itr;
+
+  // Posterior summaries, log-likelihoods in the R array and batch means of the monitored quantities
+  RGM_Posterior Pst;
+  double* LL_Memory;
+  RGM_Monitor Monitor;
+  arma::uvec Monitor_A;
+
+  // Initialize the chain with zero A and B
+  RGM_Sampler_Chain(const RGM_RNG& Chain_RNG, const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, const arma::mat& D, double n, const RGM_Settings& Settings, const RGM_Buffers& Buffers, int Chain) :
+    D(D), n(n), Settings(Settings), p(S_YY.n_cols), k(S_XX.n_cols), RNG(Chain_RNG), State(S_YY, S_YX, S_XX, n, Settings.Sparse_A),
+    Target_Accpt(0.44), Target_Accpt_Pair(0.35), Rate_A(0.44), tA(0), tB(0), t0(1), t_sd(0.1),
+    AccptA(0), AccptB(0), Accpt_tA(0), Accpt_tB(0), Iter(0), Itr(0),
+    Pst(Buffers, Chain), LL_Memory(Buffers.LL(Chain)),
+    Monitor(Settings.Stop_Rhat > 0 || Settings.Stop_ESS > 0, Settings.Monitor_A.size() + 1, p * p),
+    Monitor_A(Settings.Monitor_A) {
+
+    // Initialize Sigma_Inv
+    Sigma_Inv.set_size(p);
+
+    for (int j = 0; j < p; j++) {
+
+      Sigma_Inv(j) = RNG.Gamma(Settings.a_sigma, 1 / Settings.b_sigma);
+
+    }
+
+    // Calculate trace values with the initial Sigma_Inv
+    State.Rescale(Sigma_Inv);
+
+    // Restrict the sweep over A to the candidate entries
+    A_Mask = Candidate_Mask(p, Settings.Candidate_A);
+    A_Support = Mask_Support(A_Mask);
+
+    // Initialize Gamma and Tau matrices with Gamma[i, j] = 0 and Tau[i, j] = 0 on the diagonal and off the candidates
+    Gamma = A_Mask;
+    Tau = A_Mask;
+
+    // Initialize Rho for the spike and slab prior
+    if (!Thr) {
+
+      Rho = arma::zeros(p, p);
+
+    }
+
+    if (X) {
+
+      // Initialize Phi and Eta matrices with Phi[i, j] = 0 and Eta[i, j] = 0 if D[i, j] = 0
+      Phi = D;
+      Eta = D;
+
+      // Initialize Psi for the spike and slab prior
+      if (!Thr) {
+
+        Psi = arma::zeros(p, k);
+
+      }
+
+      // Restrict the support of B to the nonzero entries of D
+      State.Set_Support(D);
+      B_Mask = arma::conv_to<arma::mat>::from(D != 0);
+
+    }
+
+    // Initialize log proposal sds of the entries of A and B with Prop_VarA and Prop_VarB
+    Log_SdA = arma::ones(p, p) * 0.5 * log(Settings.Prop_VarA);
+
+    if (X) {
+
+      Log_SdB = arma::ones(p, k) * 0.5 * log(Settings.Prop_VarB);
+
+    }
+
+  }
+
+
+  // Start the chain at the posterior mode instead of zero A and B
+  // The indicators start at the entries that are included at the mode, and the local scales stay at 1
+  void Start_At(const RGM_Mode& Mode) {
+
+    State.A = Mode.A;
+    State.A_Pseudo = Mode.A_Pseudo;
+    State.B = Mode.B;
+    State.B_Pseudo = Mode.B_Pseudo;
+    Sigma_Inv = Mode.Sigma_Inv;
+
+    State.Refresh(Sigma_Inv);
+
+    Gamma = arma::conv_to<arma::mat>::from(Mode.Gamma > 0.5);
+
+    if (X) {
+
+      Phi = arma::conv_to<arma::mat>::from(Mode.Phi > 0.5);
+
+    }
+
+    tA = Mode.tA;
+    tB = Mode.tB;
+
+  }
+
+
+  // Sample the candidate entries of row j of A with the proposals evaluated on Chain_Threads threads
+  // The proposals and uniforms of the row are drawn in the order of the sequential sweep. A single team of threads
+  // evaluates blocks of proposals against the current state, and after a barrier one thread accepts or rejects them
+  // in order. A rejection, or an acceptance that leaves A unchanged, keeps the evaluations of the rest of the block
+  // valid, and after any other acceptance the rest of the row is evaluated again, so the chain is exactly the one of
+  // the sequential sweep. The first change of A is expected after about 1 / Rate_A proposals, so a block holds about
+  // that many proposals and at least one for every thread. With a dense (I - A)^(-1) the team also splits the columns
+  // of its update after an accepted change, which is the O(p^2) part of the sweep
+  void Sample_A_Row(int j, bool Adapt, double Step) {
+
+    const std::vector<arma::uword>& Cols = A_Support[j];
+    int nCols = Cols.size(), nThreads = Settings.Chain_Threads;
+
+    // Draw the standard normals of the proposals and the uniforms
+    std::vector<double> Z(nCols), U(nCols);
+
+    for (int m = 0; m < nCols; m++) {
+
+      Z[m] = RNG.Normal();
+      U[m] = RNG.Uniform(0, 1);
+
+    }
+
+    std::vector<RGM_State::A_Proposal> Proposals(nCols);
+
+    // Size the blocks from the observed rate of proposals that change A
+    int Block = std::max(nThreads, (int) std::min(16.0 * nThreads, std::ceil(1 / Rate_A)));
+
+    int Start = 0, End = std::min(Block, nCols), nChange = 0;
+    const double* Inv_Col = State.Inv_Column(j);
+    bool Pending = false;
+    std::string Error;
+
+#pragma omp parallel num_threads(nThreads)
+    {
+
+      while (Start < nCols) {
+
+        // Evaluate the proposals of the block against the current state
+#pragma omp for schedule(static)
+        for (int q = Start; q < End; q++) {
+
+          int l = Cols[q];
+          double a = Thr ? State.A_Pseudo(j, l) : State.A(j, l);
+
+          Proposals[q] = State.Evaluate_A<Thr, X>(j, l, a + sqrt(exp(2 * Log_SdA(j, l))) * Z[q], Inv_Col[l], Sigma_Inv, Thr ? 1 : Gamma(j, l), Tau(j, l), Settings.nu_1, tA);
+
+        }
+
+        // Accept or reject the proposals in order on one thread until one changes A, the other threads wait at the
+        // end of the block
+#pragma omp single
+        {
+
+          // Exceptions must not escape the parallel region
+          try {
+
+            bool Changed = false;
+
+            Pending = false;
+
+            while (Start < End && !Changed) {
+
+              int l = Cols[Start];
+              const RGM_State::A_Proposal& P = Proposals[Start];
+
+              // Compare u and r
+              bool Accepted = !(P.r < log(U[Start]));
+
+              if (Accepted) {
+
+                State.Commit_A<Thr, X>(j, l, P, Sigma_Inv, tA, true);
+
+                // Increase AccptA
+                AccptA = AccptA + 1;
+
+                Changed = P.Delta != 0;
+
+              }
+
+              // Adapt the proposal sd of a
+              if (Adapt) {
+
+                Adapt_Log_Sd(Log_SdA(j, l), Accepted, Target_Accpt, Step);
+
+              }
+
+              // Update Gamma
+              if (Thr) {
+
+                Gamma(j, l) = (std::abs(State.A_Pseudo(j, l)) > tA) * 1;
+
+              }
+
+              Start++;
+
+            }
+
+            // Evaluate the rest of the row again against the changed state, a dense inverse is updated by the team
+            if (Changed) {
+
+              nChange++;
+              Pending = !Settings.Sparse_A;
+              Inv_Col = State.Inv_Column(j);
+
+            }
+
+            End = std::min(Start + Block, nCols);
+
+          } catch (std::exception& e) {
+
+            Error = e.what();
+            Start = nCols;
+
+          }
+
+        }
+
+        // Update the columns of a dense (I - A)^(-1)
+        if (Pending) {
+
+#pragma omp for schedule(static)
+          for (int q = 0; q < p; q++) {
+
+            State.Update_Inverse_Columns(q, q + 1);
+
+          }
+
+        }
+
+      }
+
+    }
+
+    if (!Error.empty()) {
+
+      throw std::runtime_error(Error);
+
+    }
+
+    // Update the observed rate of proposals that change A, which only sizes the blocks
+    Rate_A = std::max(Rate_A + 0.1 * ((double) nChange / nCols - Rate_A), 1.0 / (16 * nThreads));
+
+  }
+
+
+  // Sample the entries of B row by row on Chain_Threads threads
+  // Given A and Sigma_Inv the rows of B interact only through the trace values, and the target difference of a
+  // proposal depends on them only through their changes. Every row therefore accumulates its own changes from 0,
+  // which are added to the state in row order after the sweep. Row j draws from stream j of a generator whose key
+  // is drawn from the chain once per sweep, so the samples do not depend on the number of threads
+  void Sample_B_Rows(bool Adapt, double Step) {
+
+    uint64_t Row_Key = RNG.Next64();
+
+    std::vector<RGM_State::B_Traces> Row_Traces(p);
+    std::vector<double> Row_Accpt(p, 0);
+
+#pragma omp parallel for num_threads(Settings.Chain_Threads) schedule(dynamic, 1)
+    for (int j = 0; j < p; j++) {
+
+      RGM_RNG Row_RNG(Row_Key, j);
+      RGM_State::B_Traces& T = Row_Traces[j];
+
+      T.Trace1 = 0;
+      T.Trace2 = 0;
+      T.Trace6 = 0;
+
+      // Visit only the entries with nonzero D
+      for (size_t m = 0; m < State.Support[j].size(); m++) {
+
+        int l = State.Support[j][m];
+
+        // Sample b and update acceptance counter of the row
+        bool Accepted = State.Sample_B<Thr>(Row_RNG, j, l, Sigma_Inv, Thr ? 1 : Phi(j, l), Eta(j, l), Settings.nu_2, exp(2 * Log_SdB(j, l)), tB, T);
+
+        if (Accepted) {
+
+          Row_Accpt[j] = Row_Accpt[j] + 1;
+
+        }
+
+        // Adapt the proposal sd of b
+        if (Adapt) {
+
+          Adapt_Log_Sd(Log_SdB(j, l), Accepted, Target_Accpt, Step);
+
+        }
+
+        // Update Phi
+        if (Thr) {
+
+          Phi(j, l) = (std::abs(State.B_Pseudo(j, l)) > tB) * 1;
+
+        }
+
+      }
+
+    }
+
+    // Add the changes of the rows in row order
+    for (int j = 0; j < p; j++) {
+
+      State.Add_Traces(Row_Traces[j]);
+
+      AccptB = AccptB + Row_Accpt[j];
+
+    }
+
+  }
+
+
+  // Run the iterations after Iter up to iteration Until
+  void Run(int Until) {
+
+    // Read settings
+    int nBurnin = Settings.nBurnin, Thin = Settings.Thin;
+    double a_rho = Settings.a_rho, b_rho = Settings.b_rho, nu_1 = Settings.nu_1;
+    double a_psi = Settings.a_psi, b_psi = Settings.b_psi, nu_2 = Settings.nu_2;
+    double a_sigma = Settings.a_sigma, b_sigma = Settings.b_sigma;
+
+    arma::mat& A = State.A;
+    arma::mat& B = State.B;
+    arma::mat& A_Pseudo = State.A_Pseudo;
+    arma::mat& B_Pseudo = State.B_Pseudo;
+
+    // Run a loop to do MCMC sampling
+    for (int i = Iter + 1; i <= Until; i++) {
+
+      // Adapt the proposal sds during burn-in only, with Robbins-Monro steps i^(-0.6)
+      bool Adapt = Settings.Adapt_Prop && i <= nBurnin;
+      double Step = pow(i, -0.6);
+
+      // Recalculate the sampler state from scratch every nRefresh iterations to bound rounding error
+      if (i % Settings.nRefresh == 0) {
+
+        State.Refresh(Sigma_Inv);
+
+      }
+
+      if (X) {
+
+        ////////////////////
+        // Update B
+        // The conditionals of Psi, Eta and Phi at an entry depend only on the b of that entry, which does not change
+        // before its own Metropolis step, so they are sampled for all the entries at once before the sweep
+        if (Thr) {
+
+          // Sample Eta based on b
+          Sample_Scale_Batch(RNG, B_Pseudo, B_Mask, Eta, B_Mask, nu_2);
+
+        } else {
+
+          // Sample Psi, Eta and Phi
+          Sample_Probability_Batch(RNG, Phi, Psi, B_Mask, a_psi, b_psi);
+          Sample_Scale_Batch(RNG, B, Phi, Eta, B_Mask, nu_2);
+          Sample_Indicator_Batch(RNG, B, Eta, Psi, Phi, B_Mask, nu_2);
+
+        }
+
+        if (Settings.Parallel_B) {
+
+          Sample_B_Rows(Adapt, Step);
+
+        } else {
+
+          for (int j = 0; j < p; j++) {
+
+            // Visit only the entries with nonzero D
+            for (size_t m = 0; m < State.Support[j].size(); m++) {
+
+              int l = State.Support[j][m];
+
+              // Sample b and update acceptance counter
+              bool Accepted = State.Sample_B<Thr>(RNG, j, l, Sigma_Inv, Thr ? 1 : Phi(j, l), Eta(j, l), nu_2, exp(2 * Log_SdB(j, l)), tB);
+
+              if (Accepted) {
+
+                // Increase AccptB
+                AccptB = AccptB + 1;
+
+              }
+
+              // Adapt the proposal sd of b
+              if (Adapt) {
+
+                Adapt_Log_Sd(Log_SdB(j, l), Accepted, Target_Accpt, Step);
+
+              }
+
+              // Update Phi
+              if (Thr) {
+
+                Phi(j, l) = (std::abs(B_Pseudo(j, l)) > tB) * 1;
+
+              }
+
+            }
+
+          }
+
+        }
+
+        if (Thr) {
+
+          // Propose tB_new
+          double tB_new = Sample_tn(RNG, tB, t_sd, 0, t0);
+
+          // Calculate difference from the entries of B that change with tB_new
+          double Diff = State.Propose_Threshold_B(tB_new, Sigma_Inv) + log(tn_pdf(tB, tB_new, t_sd, 0, t0)) - log(tn_pdf(tB_new, tB, t_sd, 0, t0));
+
+          // Compare Diff with log of a random number from Uniform(0, 1)
+          if (Diff > log(RNG.Uniform(0, 1))) {
+
+            // Keep the new B and update tB and Accpt_tB
+            State.Accept_Threshold();
+
+            tB = tB_new;
+
+            Accpt_tB = Accpt_tB + 1;
+
+          } else {
+
+            // Restore B
+            State.Reject_Threshold();
+
+          }
+
+        }
+
+      }
+
+
+      ////////////////////
+      // Update Sigma
+      for (int j = 0; j < p; j++) {
+
+        // Calculate Sum
+        double z_sum = State.Row_Sum(j);
+
+        // Sample Sigma_Inv
+        Sigma_Inv(j) = 1 / Sample_Sigma(RNG, n, z_sum, a_sigma, b_sigma);
+
+      }
+
+      // Rescale trace values with the new Sigma_Inv
+      State.Rescale(Sigma_Inv);
+
+
+      ////////////////////
+      // Update A
+      // Rho, Tau and Gamma are sampled for all the off-diagonal entries at once before the sweep as for B
+      if (Thr) {
+
+        // Sample Tau based on a
+        Sample_Scale_Batch(RNG, A_Pseudo, A_Mask, Tau, A_Mask, nu_1);
+
+      } else {
+
+        // Sample Rho, Tau and Gamma
+        Sample_Probability_Batch(RNG, Gamma, Rho, A_Mask, a_rho, b_rho);
+        Sample_Scale_Batch(RNG, A, Gamma, Tau, A_Mask, nu_1);
+        Sample_Indicator_Batch(RNG, A, Tau, Rho, Gamma, A_Mask, nu_1);
+
+      }
+
+      for (int j = 0; j < p; j++) {
+
+        // Evaluate the proposals of the row on several threads when there are no pairs and every thread has a proposal
+        if (Settings.Chain_Threads > 1 && !Settings.Pair_A && (int) A_Support[j].size() >= Settings.Chain_Threads) {
+
+          Sample_A_Row(j, Adapt, Step);
+
+          continue;
+
+        }
+
+        // Visit only the candidate entries
+        for (size_t m = 0; m < A_Support[j].size(); m++) {
+
+          int l = A_Support[j][m];
+
+          // Sample the reciprocal pairs whose entries are both candidates jointly, each pair is visited once from
+          // its entry above the diagonal
+          bool Pair = Settings.Pair_A && A_Mask(l, j) != 0;
+
+          if (Pair && l > j) {
+
+            bool Accepted = State.Sample_A_Pair<Thr, X>(RNG, j, l, Sigma_Inv, Thr ? 1 : Gamma(j, l), Tau(j, l), Thr ? 1 : Gamma(l, j), Tau(l, j), nu_1, exp(2 * Log_SdA(j, l)), exp(2 * Log_SdA(l, j)), tA);
+
+            if (Accepted) {
+
+              // Increase AccptA by both entries
+              AccptA = AccptA + 2;
+
+            }
+
+            // Adapt the proposal sds of the pair
+            if (Adapt) {
+
+              Adapt_Log_Sd(Log_SdA(j, l), Accepted, Target_Accpt_Pair, Step);
+              Adapt_Log_Sd(Log_SdA(l, j), Accepted, Target_Accpt_Pair, Step);
+
+            }
+
+            // Update Gamma
+            if (Thr) {
+
+              Gamma(j, l) = (std::abs(A_Pseudo(j, l)) > tA) * 1;
+              Gamma(l, j) = (std::abs(A_Pseudo(l, j)) > tA) * 1;
+
+            }
+
+          }
+
+          // Sample the other entries one at a time
+          if (!Pair) {
+
+            // Sample a and update acceptance counter
+            bool Accepted = State.Sample_A<Thr, X>(RNG, j, l, Sigma_Inv, Thr ? 1 : Gamma(j, l), Tau(j, l), nu_1, exp(2 * Log_SdA(j, l)), tA);
+
+            if (Accepted) {
+
+              // Increase AccptA
+              AccptA = AccptA + 1;
+
+            }
+
+            // Adapt the proposal sd of a
+            if (Adapt) {
+
+              Adapt_Log_Sd(Log_SdA(j, l), Accepted, Target_Accpt, Step);
+
+            }
+
+            // Update Gamma
+            if (Thr) {
+
+              Gamma(j, l) = (std::abs(A_Pseudo(j, l)) > tA) * 1;
+
+            }
+
+          }
+
+        }
+
+      }
+
+      if (Thr) {
+
+        // Propose tA_new
+        double tA_new = Sample_tn(RNG, tA, t_sd, 0, t0);
+
+        // Calculate Difference from the entries of A that change with tA_new
+        double Diff_A = State.Propose_Threshold_A(tA_new, Sigma_Inv) + log(tn_pdf(tA, tA_new, t_sd, 0, t0)) - log(tn_pdf(tA_new, tA, t_sd, 0, t0));
+
+        // Compare Diff with log of a random number from uniform(0, 1)
+        if (Diff_A > log(RNG.Uniform(0, 1))) {
+
+          // Keep the new A and update tA and Accpt_tA
+          State.Accept_Threshold();
+
+          tA = tA_new;
+
+          Accpt_tA = Accpt_tA + 1;
+
+        } else {
+
+          // Restore A
+          State.Reject_Threshold();
+
+        }
+
+      }
+
+
+      // Store posterior samples
+      if((i > nBurnin) && (i % Thin == 0)){
+
+        Pst.Add("A", A);
+        if (Thr) Pst.Add("A0", A_Pseudo);
+        if (X) Pst.Add("B", B);
+        if (Thr && X) Pst.Add("B0", B_Pseudo);
+        Pst.Add("Gamma", Gamma);
+        Pst.Add("Tau", Tau);
+        if (!Thr) Pst.Add("Rho", Rho);
+        if (X) Pst.Add("Phi", Phi);
+        if (X) Pst.Add("Eta", Eta);
+        if (!Thr && X) Pst.Add("Psi", Psi);
+        if (Thr) Pst.Add("tA", tA);
+        if (Thr && X) Pst.Add("tB", tB);
+        Pst.Add("Sigma", 1 / Sigma_Inv.t());
+        LL_Memory[Itr] = State.Log_Likelihood(Sigma_Inv);
+
+        // Add the monitored quantities
+        if (Monitor.Enabled) {
+
+          Monitor.Add(LL_Memory[Itr], A.elem(Monitor_A), Gamma);
+
+        }
+
+        // Increase Itr by 1
+        Itr = Itr + 1;
+
+      }
+
+      // Count the iteration
+      Iter = i;
+
+    }
+
+  }
+
+
+  // Save or restore the state of the chain with its generator, posterior summaries, samples and batch means
+  // The data and settings are saved once for all the chains, and everything derived from them is left as it is
+  template <typename Archive>
+  void Serialize(Archive& Ar) {
+
+    RNG.Serialize(Ar);
+    State.Serialize(Ar);
+    Ar.Matrix(Sigma_Inv);
+    Ar.Matrix(Gamma);
+    Ar.Matrix(Tau);
+    Ar.Matrix(Rho);
+    Ar.Matrix(Psi);
+    Ar.Matrix(Phi);
+    Ar.Matrix(Eta);
+    Ar.Matrix(Log_SdA);
+    Ar.Matrix(Log_SdB);
+    Ar.Value(tA);
+    Ar.Value(tB);
+    Ar.Value(AccptA);
+    Ar.Value(AccptB);
+    Ar.Value(Accpt_tA);
+    Ar.Value(Accpt_tB);
+    Ar.Value(Iter);
+    Ar.Value(Itr);
+    Ar.Bytes(LL_Memory, (size_t) Itr * sizeof(double));
+    Pst.Serialize(Ar);
+    Monitor.Serialize(Ar);
+
+  }
+
+
+  // Return estimates based on posterior samples, the graph structures are constructed from Gamma_Est and Phi_Est
+  RGM_Chain Output() {
+
+    RGM_Chain Output;
+
+    Output.Add("A_Est", Pst.Mean("A"));
+    if (X) Output.Add("B_Est", Pst.Mean("B"));
+    Output.Add("zA_Est", arma::conv_to<arma::mat>::from(Pst.Mean("Gamma") > 0.5));
+    if (X) Output.Add("zB_Est", arma::conv_to<arma::mat>::from(Pst.Mean("Phi") > 0.5));
+    if (Thr) Output.Add("A0_Est", Pst.Mean("A0"));
+    if (Thr && X) Output.Add("B0_Est", Pst.Mean("B0"));
+    Output.Add("Gamma_Est", Pst.Mean("Gamma"));
+    Output.Add("Tau_Est", Pst.Mean("Tau"));
+    if (!Thr) Output.Add("Rho_Est", Pst.Mean("Rho"));
+    if (X) Output.Add("Phi_Est", Pst.Mean("Phi"));
+    if (X) Output.Add("Eta_Est", Pst.Mean("Eta"));
+    if (!Thr && X) Output.Add("Psi_Est", Pst.Mean("Psi"));
+    if (Thr) Output.Add("tA_Est", Pst.Mean("tA")(0, 0));
+    if (Thr && X) Output.Add("tB_Est", Pst.Mean("tB")(0, 0));
+    Output.Add("Sigma_Est", Pst.Mean("Sigma"));
+    Output.Add("AccptA", AccptA / (arma::accu(A_Mask) * Iter) * 100);
+    if (X) Output.Add("AccptB", AccptB / (arma::accu(D) * Iter) * 100);
+    if (Thr) Output.Add("Accpt_tA", Accpt_tA / (Iter) * 100);
+    if (Thr && X) Output.Add("Accpt_tB", Accpt_tB / (Iter) * 100);
+    Output.Add("Prop_VarA_Est", arma::exp(2 * Log_SdA) % A_Mask);
+    if (X) Output.Add("Prop_VarB_Est", arma::exp(2 * Log_SdB) % B_Mask);
+
+    Output.Add_Samples(Pst);
+
+    return Output;
+
+  }
+
+};
+
+
+// Convert 1-based column major indices of entries of A from R, such as the monitored or the candidate entries
+std::vector<arma::uword> Entry_Index(const Rcpp::IntegerVector& Entries) {
+
+  std::vector<arma::uword> Index;
+
+  for (int m = 0; m < Entries.size(); m++) {
+
+    Index.push_back(Entries[m] - 1);
+
+  }
+
+  return Index;
+
+}
+
+
+// Run nChains chains of MCMC sampling and pool their outputs
+template <typename Prior, typename Model>
+Rcpp::List RGM_Sampler(const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, const arma::mat& D, double n, const RGM_Settings& Settings, int nChains, Rcpp::CharacterVector Store_Pst, bool Pack_Pst){
+
+  // Check number of chains
+  if (nChains < 1) {
+
+    Rcpp::stop("Number of chains should be a positive integer.");
+
+  }
+
+  // Convert names of the arrays whose full samples are kept
+  std::vector<std::string> Store = Rcpp::as<std::vector<std::string> >(Store_Pst);
+
+  // Allocate the R arrays the chains write their posterior samples into
+  RGM_Buffers Buffers(Store, Pack_Pst, Settings.nPst(), nChains);
+
+  Allocate_Buffers<Prior, Model>(Buffers, S_YY.n_cols, S_XX.n_cols);
+
+  // Initialize the chains, every chain gets its own stream of a generator seeded from R's RNG on the main thread,
+  // so results are reproducible with set.seed() regardless of the number of threads
+  uint64_t Seed = Draw_Seed();
+  std::vector<RGM_Sampler_Chain<Prior, Model> > Chains;
+
+  Chains.reserve(nChains);
+
+  for (int c = 0; c < nChains; c++) {
+
+    Chains.emplace_back(RGM_RNG(Seed, c), S_YY, S_YX, S_XX, D, n, Settings, Buffers, c);
+
+  }
+
+  // Start every chain at the posterior mode, which is found once as it does not depend on the chain
+  if (Settings.Init_MAP) {
+
+    RGM_Mode Mode = Find_Mode<Prior, Model>(S_YY, S_YX, S_XX, D, n, Settings);
+
+    for (int c = 0; c < nChains; c++) {
+
+      Chains[c].Start_At(Mode);
+
+    }
+
+  }
+
+  // Run the chains in parallel and pool their outputs
+  return Run_Chains(Chains, Buffers, Settings);
+
+}
+
+
+// Restore the chains of a checkpoint, run them in parallel and pool their outputs
+// The posterior samples stored so far are restored into buffers sized for the number of iterations in the settings
+template <typename Prior, typename Model>
+Rcpp::List RGM_Resume_Sampler(Checkpoint_Archive& Ar, const RGM_Checkpoint& Header) {
+
+  const RGM_Settings& Settings = Header.Settings;
+
+  // Allocate the R arrays the chains write their posterior samples into
+  RGM_Buffers Buffers(Header.Store_Pst, Header.Pack_Pst, Settings.nPst(), Header.nChains);
+
+  Allocate_Buffers<Prior, Model>(Buffers, Header.S_YY.n_cols, Header.S_XX.n_cols);
+
+  // Initialize the chains and overwrite their state with the checkpoint
+  std::vector<RGM_Sampler_Chain<Prior, Model> > Chains;
+
+  Chains.reserve(Header.nChains);
+
+  for (int c = 0; c < Header.nChains; c++) {
+
+    Chains.emplace_back(RGM_RNG(0, c), Header.S_YY, Header.S_YX, Header.S_XX, Header.D, Header.n, Settings, Buffers, c);
+    Chains[c].Serialize(Ar);
+
+  }
+
+  // Run the chains in parallel and pool their outputs
+  return Run_Chains(Chains, Buffers, Settings, Header.Stop_Reason);
+
+}
+
+
+// Do MCMC sampling with threshold prior for the model when both X and Y are there
+// [[Rcpp::export]]
+Rcpp::List RGM_Threshold2(const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, const arma::mat& D, double n, int nIter, int nBurnin, int Thin, double nu_1 = 0.0001, double nu_2 = 0.0001, double a_sigma = 0.01, double b_sigma = 0.01, double Prop_VarA = 0.01, double Prop_VarB = 0.01, int nChains = 1, int nRefresh = 100, Rcpp::CharacterVector Store_Pst = Rcpp::CharacterVector::create("Gamma_Pst"), bool Pack_Pst = false, bool Pair_A = false, bool Adapt_Prop = true, double Stop_Rhat = 0, double Stop_ESS = 0, int Check_Every = 1000, Rcpp::IntegerVector Monitor_A = Rcpp::IntegerVector::create(), std::string Checkpoint_File = "", int Checkpoint_Every = 1000, bool Init_MAP = false, int MAP_Iter = 100, double MAP_Tol = 1e-6, Rcpp::IntegerVector Candidate_A = Rcpp::IntegerVector::create(), bool Sparse_A = false, int Chain_Threads = 1, bool Parallel_B = false){
+
+  RGM_Settings Settings;
+
+  Settings.nIter = nIter;
+  Settings.nBurnin = nBurnin;
+  Settings.Thin = Thin;
+
+  Settings.nu_1 = nu_1;
+  Settings.nu_2 = nu_2;
+  Settings.a_sigma = a_sigma;
+  Settings.b_sigma = b_sigma;
+
+  Settings.Prop_VarA = Prop_VarA;
+  Settings.Prop_VarB = Prop_VarB;
+  Settings.nRefresh = nRefresh;
+  Settings.Pair_A = Pair_A;
+  Settings.Adapt_Prop = Adapt_Prop;
+
+  Settings.Stop_Rhat = Stop_Rhat;
+  Settings.Stop_ESS = Stop_ESS;
+  Settings.Check_Every = Check_Every;
+  Settings.Monitor_A = Entry_Index(Monitor_A);
+
+  Settings.Checkpoint_File = Checkpoint_File;
+  Settings.Checkpoint_Every = Checkpoint_Every;
+
+  Settings.Init_MAP = Init_MAP;
+  Settings.MAP_Iter = MAP_Iter;
+  Settings.MAP_Tol = MAP_Tol;
+
+  Settings.Candidate_A = Entry_Index(Candidate_A);
+  Settings.Sparse_A = Sparse_A;
+  Settings.Chain_Threads = Chain_Threads;
+  Settings.Parallel_B = Parallel_B;
+
+  return RGM_Sampler<Threshold_Prior, XY_Model>(S_YY, S_YX, S_XX, D, n, Settings, nChains, Store_Pst, Pack_Pst);
+
+}
+
+
+// Do MCMC sampling with Spike and Slab Prior for the model when both X and Y are there
+// [[Rcpp::export]]
+Rcpp::List RGM_SpikeSlab2(const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, const arma::mat& D, double n, int nIter, int nBurnin, int Thin, double a_rho = 3.0, double b_rho = 1.0, double nu_1 = 0.001, double a_psi = 0.5, double b_psi = 0.5, double nu_2 = 0.0001, double a_sigma = 0.01, double b_sigma = 0.01, double Prop_VarA = 0.01, double Prop_VarB = 0.01, int nChains = 1, int nRefresh = 100, Rcpp::CharacterVector Store_Pst = Rcpp::CharacterVector::create("Gamma_Pst"), bool Pack_Pst = false, bool Pair_A = false, bool Adapt_Prop = true, double Stop_Rhat = 0, double Stop_ESS = 0, int Check_Every = 1000, Rcpp::IntegerVector Monitor_A = Rcpp::IntegerVector::create(), std::string Checkpoint_File = "", int Checkpoint_Every = 1000, bool Init_MAP = false, int MAP_Iter = 100, double MAP_Tol = 1e-6, Rcpp::IntegerVector Candidate_A = Rcpp::IntegerVector::create(), bool Sparse_A = false, int Chain_Threads = 1, bool Parallel_B = false){
+
+  RGM_Settings Settings;
+
+  Settings.nIter = nIter;
+  Settings.nBurnin = nBurnin;
+  Settings.Thin = Thin;
+
+  Settings.a_rho = a_rho;
+  Settings.b_rho = b_rho;
+  Settings.nu_1 = nu_1;
+  Settings.a_psi = a_psi;
+  Settings.b_psi = b_psi;
+  Settings.nu_2 = nu_2;
+  Settings.a_sigma = a_sigma;
+  Settings.b_sigma = b_sigma;
+
+  Settings.Prop_VarA = Prop_VarA;
+  Settings.Prop_VarB = Prop_VarB;
+  Settings.nRefresh = nRefresh;
+  Settings.Pair_A = Pair_A;
+  Settings.Adapt_Prop = Adapt_Prop;
+
+  Settings.Stop_Rhat = Stop_Rhat;
+  Settings.Stop_ESS = Stop_ESS;
+  Settings.Check_Every = Check_Every;
+  Settings.Monitor_A = Entry_Index(Monitor_A);
+
+  Settings.Checkpoint_File = Checkpoint_File;
+  Settings.Checkpoint_Every = Checkpoint_Every;
+
+  Settings.Init_MAP = Init_MAP;
+  Settings.MAP_Iter = MAP_Iter;
+  Settings.MAP_Tol = MAP_Tol;
+
+  Settings.Candidate_A = Entry_Index(Candidate_A);
+  Settings.Sparse_A = Sparse_A;
+  Settings.Chain_Threads = Chain_Threads;
+  Settings.Parallel_B = Parallel_B;
+
+  return RGM_Sampler<SpikeSlab_Prior, XY_Model>(S_YY, S_YX, S_XX, D, n, Settings, nChains, Store_Pst, Pack_Pst);
+
+}
+
+
+// Do MCMC sampling with threshold prior for the model when only Y is there
+// [[Rcpp::export]]
+Rcpp::List RGM_Threshold1(const arma::mat& S_YY, double n, int nIter, int nBurnin, int Thin, double nu_1 = 0.0001, double a_sigma = 0.01, double b_sigma = 0.01, double Prop_VarA = 0.01, int nChains = 1, int nRefresh = 100, Rcpp::CharacterVector Store_Pst = Rcpp::CharacterVector::create("Gamma_Pst"), bool Pack_Pst = false, bool Pair_A = false, bool Adapt_Prop = true, double Stop_Rhat = 0, double Stop_ESS = 0, int Check_Every = 1000, Rcpp::IntegerVector Monitor_A = Rcpp::IntegerVector::create(), std::string Checkpoint_File = "", int Checkpoint_Every = 1000, bool Init_MAP = false, int MAP_Iter = 100, double MAP_Tol = 1e-6, Rcpp::IntegerVector Candidate_A = Rcpp::IntegerVector::create(), bool Sparse_A = false, int Chain_Threads = 1){
+
+  RGM_Settings Settings;
+
+  Settings.nIter = nIter;
+  Settings.nBurnin = nBurnin;
+  Settings.Thin = Thin;
+
+  Settings.nu_1 = nu_1;
+  Settings.a_sigma = a_sigma;
+  Settings.b_sigma = b_sigma;
+
+  Settings.Prop_VarA = Prop_VarA;
+  Settings.nRefresh = nRefresh;
+  Settings.Pair_A = Pair_A;
+  Settings.Adapt_Prop = Adapt_Prop;
+
+  Settings.Stop_Rhat = Stop_Rhat;
+  Settings.Stop_ESS = Stop_ESS;
+  Settings.Check_Every = Check_Every;
+  Settings.Monitor_A = Entry_Index(Monitor_A);
+
+  Settings.Checkpoint_File = Checkpoint_File;
+  Settings.Checkpoint_Every = Checkpoint_Every;
+
+  Settings.Init_MAP = Init_MAP;
+  Settings.MAP_Iter = MAP_Iter;
+  Settings.MAP_Tol = MAP_Tol;
+
+  Settings.Candidate_A = Entry_Index(Candidate_A);
+  Settings.Sparse_A = Sparse_A;
+  Settings.Chain_Threads = Chain_Threads;
+
+  // Initialize S_YX, S_XX and D without any columns as there is no X
+  arma::mat None = arma::zeros(S_YY.n_cols, 0);
+
+  return RGM_Sampler<Threshold_Prior, Y_Model>(S_YY, None, arma::zeros(0, 0), None, n, Settings, nChains, Store_Pst, Pack_Pst);
+
+}
+
+
+// Do MCMC sampling with Spike and Slab Prior for the model when only Y is there
+// [[Rcpp::export]]
+Rcpp::List RGM_SpikeSlab1(const arma::mat& S_YY, double n, int nIter, int nBurnin, int Thin, double a_rho = 3.0, double b_rho = 1.0, double nu_1 = 0.001, double a_sigma = 0.01, double b_sigma = 0.01, double Prop_VarA = 0.01, int nChains = 1, int nRefresh = 100, Rcpp::CharacterVector Store_Pst = Rcpp::CharacterVector::create("Gamma_Pst"), bool Pack_Pst = false, bool Pair_A = false, bool Adapt_Prop = true, double Stop_Rhat = 0, double Stop_ESS = 0, int Check_Every = 1000, Rcpp::IntegerVector Monitor_A = Rcpp::IntegerVector::create(), std::string Checkpoint_File = "", int Checkpoint_Every = 1000, bool Init_MAP = false, int MAP_Iter = 100, double MAP_Tol = 1e-6, Rcpp::IntegerVector Candidate_A = Rcpp::IntegerVector::create(), bool Sparse_A = false, int Chain_Threads = 1){
+
+  RGM_Settings Settings;
+
+  Settings.nIter = nIter;
+  Settings.nBurnin = nBurnin;
+  Settings.Thin = Thin;
+
+  Settings.a_rho = a_rho;
+  Settings.b_rho = b_rho;
+  Settings.nu_1 = nu_1;
+  Settings.a_sigma = a_sigma;
+  Settings.b_sigma = b_sigma;
+
+  Settings.Prop_VarA = Prop_VarA;
+  Settings.nRefresh = nRefresh;
+  Settings.Pair_A = Pair_A;
+  Settings.Adapt_Prop = Adapt_Prop;
+
+  Settings.Stop_Rhat = Stop_Rhat;
+  Settings.Stop_ESS = Stop_ESS;
+  Settings.Check_Every = Check_Every;
+  Settings.Monitor_A = Entry_Index(Monitor_A);
+
+  Settings.Checkpoint_File = Checkpoint_File;
+  Settings.Checkpoint_Every = Checkpoint_Every;
+
+  Settings.Init_MAP = Init_MAP;
+  Settings.MAP_Iter = MAP_Iter;
+  Settings.MAP_Tol = MAP_Tol;
+
+  Settings.Candidate_A = Entry_Index(Candidate_A);
+  Settings.Sparse_A = Sparse_A;
+  Settings.Chain_Threads = Chain_Threads;
+
+  // Initialize S_YX, S_XX and D without any columns as there is no X
+  arma::mat None = arma::zeros(S_YY.n_cols, 0);
+
+  return RGM_Sampler<SpikeSlab_Prior, Y_Model>(S_YY, None, arma::zeros(0, 0), None, n, Settings, nChains, Store_Pst, Pack_Pst);
+
+}
+
+
+// Find the posterior mode with a prior and a model and return its estimates
+template <typename Prior, typename Model>
+Rcpp::List RGM_Mode_Output(const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, const arma::mat& D, double n, const RGM_Settings& Settings) {
+
+  const bool Thr = Prior::Thresholded, X = Model::Has_X;
+
+  RGM_Mode Mode = Find_Mode<Prior, Model>(S_YY, S_YX, S_XX, D, n, Settings);
+
+  // Collect estimates in the order of the sampler outputs
+  RGM_Chain Output;
+
+  Output.Add("A_Est", Mode.A);
+  if (X) Output.Add("B_Est", Mode.B);
+  Output.Add("zA_Est", arma::conv_to<arma::mat>::from(Mode.Gamma > 0.5));
+  if (X) Output.Add("zB_Est", arma::conv_to<arma::mat>::from(Mode.Phi > 0.5));
+  if (Thr) Output.Add("A0_Est", Mode.A_Pseudo);
+  if (Thr && X) Output.Add("B0_Est", Mode.B_Pseudo);
+  Output.Add("Gamma_Est", Mode.Gamma);
+  if (X) Output.Add("Phi_Est", Mode.Phi);
+  if (Thr) Output.Add("tA_Est", Mode.tA);
+  if (Thr && X) Output.Add("tB_Est", Mode.tB);
+  Output.Add("Sigma_Est", 1 / Mode.Sigma_Inv.t());
+  Output.Add("LL_Est", Mode.LL);
+  Output.Add("nSweep", Mode.nSweep);
+
+  // Convert to an R list
+  int nOut = Output.Names.size();
+  Rcpp::List List(nOut + 1);
+  Rcpp::CharacterVector Names(nOut + 1);
+
+  for (int m = 0; m < nOut; m++) {
+
+    Names[m] = Output.Names[m];
+
+    if (Output.Scalar[m]) {
+
+      List[m] = Output.Values[m](0, 0);
+
+    } else {
+
+      List[m] = Output.Values[m];
+
+    }
+
+  }
+
+  Names[nOut] = "Converged";
+  List[nOut] = Mode.Converged;
+
+  List.attr("names") = Names;
+
+  return List;
+
+}
+
+
+// Find the posterior mode by coordinate ascent, with the threshold prior if Thresholded and the spike and slab prior otherwise
+// Without X, S_YX and D have no columns and S_XX is empty
+// [[Rcpp::export]]
+Rcpp::List RGM_MAP(const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, const arma::mat& D, double n, bool Thresholded, double a_rho = 3.0, double b_rho = 1.0, double nu_1 = 0.001, double a_psi = 0.5, double b_psi = 0.5, double nu_2 = 0.0001, double a_sigma = 0.01, double b_sigma = 0.01, int MAP_Iter = 100, double MAP_Tol = 1e-6, Rcpp::IntegerVector Candidate_A = Rcpp::IntegerVector::create(), bool Sparse_A = false){
+
+  RGM_Settings Settings;
+
+  Settings.a_rho = a_rho;
+  Settings.b_rho = b_rho;
+  Settings.nu_1 = nu_1;
+  Settings.a_psi = a_psi;
+  Settings.b_psi = b_psi;
+  Settings.nu_2 = nu_2;
+  Settings.a_sigma = a_sigma;
+  Settings.b_sigma = b_sigma;
+
+  Settings.Init_MAP = true;
+  Settings.MAP_Iter = MAP_Iter;
+  Settings.MAP_Tol = MAP_Tol;
+
+  Settings.Candidate_A = Entry_Index(Candidate_A);
+  Settings.Sparse_A = Sparse_A;
+
+  bool Has_X = S_XX.n_cols > 0;
+
+  if (Thresholded && Has_X) {
+
+    return RGM_Mode_Output<Threshold_Prior, XY_Model>(S_YY, S_YX, S_XX, D, n, Settings);
+
+  } else if (Has_X) {
+
+    return RGM_Mode_Output<SpikeSlab_Prior, XY_Model>(S_YY, S_YX, S_XX, D, n, Settings);
+
+  } else if (Thresholded) {
+
+    return RGM_Mode_Output<Threshold_Prior, Y_Model>(S_YY, S_YX, S_XX, D, n, Settings);
+
+  }
+
+  return RGM_Mode_Output<SpikeSlab_Prior, Y_Model>(S_YY, S_YX, S_XX, D, n, Settings);
+
+}
+
+
+// Resume MCMC sampling from a checkpoint file and run the chains up to nIter iterations
+// nIter = 0 keeps the number of iterations of the original run, a larger nIter extends a finished run
+// [[Rcpp::export]]
+Rcpp::List RGM_Resume_cpp(std::string Checkpoint_File, int nIter = 0){
+
+  // Read the contents of the checkpoint besides the chains
+  Checkpoint_Archive Ar(Checkpoint_File, true);
+  RGM_Checkpoint Header = RGM_Checkpoint();
+
+  Header.Serialize(Ar);
+
+  // Change the number of iterations
+  if (nIter > 0) {
+
+    if (nIter < Header.Done) {
+
+      Rcpp::stop("Number of iterations should be at least the " + std::to_string(Header.Done) + " iterations already run.");
+
+    }
+
+    if (nIter <= Header.Settings.nBurnin) {
+
+      Rcpp::stop("Number of iterations should be greater than the number of burnin points.");
+
+    }
+
+    // Sampling that stopped at convergence continues until the thresholds are met at a later check
+    if (nIter > Header.Done) {
+
+      Header.Stop_Reason = "nIter";
+
+    }
+
+    Header.Settings.nIter = nIter;
+
+  }
+
+  // Keep saving checkpoints to the file the run is resumed from
+  Header.Settings.Checkpoint_File = Checkpoint_File;
+
+  // Restore the chains with the prior and model of the checkpoint
+  if (Header.Thresholded && Header.Has_X) {
+
+    return RGM_Resume_Sampler<Threshold_Prior, XY_Model>(Ar, Header);
+
+  } else if (Header.Has_X) {
+
+    return RGM_Resume_Sampler<SpikeSlab_Prior, XY_Model>(Ar, Header);
+
+  } else if (Header.Thresholded) {
+
+    return RGM_Resume_Sampler<Threshold_Prior, Y_Model>(Ar, Header);
+
+  }
+
+  return RGM_Resume_Sampler<SpikeSlab_Prior, Y_Model>(Ar, Header);
+
+}
+
+
+
+
+
+// Define the function NetworkMotif_cpp with two parameters: Gamma and Gamma_Pst
+// The function calculates the network motif based on the given parameters
+// [[Rcpp::export]]
+double NetworkMotif_cpp(const arma::mat& Gamma, const arma::cube& Gamma_Pst, int nThreads = 1) {
+
+  // Pack the posterior samples and Gamma into bits
+  Packed_Array Pst = Pack_Cube(Gamma_Pst, nThreads);
+  Packed_Array Mask(Gamma.n_rows, Gamma.n_cols, 1);
+  Mask.Set_Slice(0, Gamma);
+
+  // Return the proportion of matching network motifs to the total number of posterior samples
+  return Count_Motifs(Pst, Mask, nThreads)(0) / Gamma_Pst.n_slices;
+
+}
+
+
+// Calculate the network motif when the posterior samples are packed into bits
+// [[Rcpp::export]]
+double NetworkMotif_Packed_cpp(const arma::mat& Gamma, const Rcpp::RawVector& Gamma_Pst, int nThreads = 1) {
+
+  // View the packed posterior samples and pack Gamma into bits
+  Packed_View Pst(Gamma_Pst);
+  Packed_Array Mask(Gamma.n_rows, Gamma.n_cols, 1);
+  Mask.Set_Slice(0, Gamma);
+
+  // Return the proportion of matching network motifs to the total number of posterior samples
+  return Count_Motifs(Pst, Mask, nThreads)(0) / Pst.n_slices;
+
+}
+
+
+// Calculate the network motifs of all the slices of Gammas in a single pass over the posterior samples
+// [[Rcpp::export]]
+arma::colvec NetworkMotif_Batch_cpp(const arma::cube& Gammas, const arma::cube& Gamma_Pst, int nThreads = 1) {
+
+  // Pack the posterior samples and the motifs into bits
+  Packed_Array Pst = Pack_Cube(Gamma_Pst, nThreads);
+  Packed_Array Masks = Pack_Cube(Gammas, nThreads);
+
+  // Return the proportions of matching network motifs
+  return Count_Motifs(Pst, Masks, nThreads) / Gamma_Pst.n_slices;
+
+}
+
+
+// Calculate the network motifs of all the slices of Gammas when the posterior samples are packed into bits
+// [[Rcpp::export]]
+arma::colvec NetworkMotif_Batch_Packed_cpp(const arma::cube& Gammas, const Rcpp::RawVector& Gamma_Pst, int nThreads = 1) {
+
+  // View the packed posterior samples and pack the motifs into bits
+  Packed_View Pst(Gamma_Pst);
+  Packed_Array Masks = Pack_Cube(Gammas, nThreads);
+
+  // Return the proportions of matching network motifs
+  return Count_Motifs(Pst, Masks, nThreads) / Pst.n_slices;
+
+}
+
+
+
+// Convert a 1 based edge list of motifs to 0 based motif indices and column major edge indices
+void Motif_Edge_List(const Rcpp::IntegerVector& Motif, const Rcpp::IntegerVector& Row, const Rcpp::IntegerVector& Col, int p,
+                     std::vector<int>& Motif_Index, std::vector<arma::uword>& Edge_Index) {
+
+  for (int e = 0; e < Motif.size(); e++) {
+
+    Motif_Index.push_back(Motif[e] - 1);
+    Edge_Index.push_back((Row[e] - 1) + (arma::uword) (Col[e] - 1) * p);
+
+  }
+
+}
+
+
+// Calculate the network motifs of nMotif motifs given as an edge list from an inverted index of the posterior samples
+// [[Rcpp::export]]
+arma::colvec NetworkMotif_Edges_cpp(const Rcpp::IntegerVector& Motif, const Rcpp::IntegerVector& Row, const Rcpp::IntegerVector& Col, int nMotif, const arma::cube& Gamma_Pst, int nThreads = 1) {
+
+  // Convert the edge list
+  std::vector<int> Motif_Index;
+  std::vector<arma::uword> Edge_Index;
+  Motif_Edge_List(Motif, Row, Col, Gamma_Pst.n_rows, Motif_Index, Edge_Index);
+
+  // Return the proportions of matching network motifs
+  return Count_Motif_Edges(Dense_View(Gamma_Pst), Motif_Index, Edge_Index, nMotif, nThreads) / Gamma_Pst.n_slices;
+
+}
+
+
+// Calculate the network motifs of nMotif motifs given as an edge list when the posterior samples are packed into bits
+// [[Rcpp::export]]
+arma::colvec NetworkMotif_Edges_Packed_cpp(const Rcpp::IntegerVector& Motif, const Rcpp::IntegerVector& Row, const Rcpp::IntegerVector& Col, int nMotif, const Rcpp::RawVector& Gamma_Pst, int nThreads = 1) {
+
+  // View the packed posterior samples
+  Packed_View Pst(Gamma_Pst);
+
+  // Convert the edge list
+  std::vector<int> Motif_Index;
+  std::vector<arma::uword> Edge_Index;
+  Motif_Edge_List(Motif, Row, Col, Pst.n_rows, Motif_Index, Edge_Index);
+
+  // Return the proportions of matching network motifs
+  return Count_Motif_Edges(Pst, Motif_Index, Edge_Index, nMotif, nThreads) / Pst.n_slices;
+
+}
+
+// Decode the slices of packed posterior samples, Slices are 1 based
+// [[Rcpp::export]]
+arma::cube Unpack_Pst_cpp(const Rcpp::RawVector& Pst, const Rcpp::IntegerVector& Slices) {
+
+  // View the packed posterior samples
+  Packed_View Packed(Pst);
+
+  // Decode the requested slices
+  arma::cube Out(Packed.n_rows, Packed.n_cols, Slices.size());
+
+  for (int s = 0; s < Slices.size(); s++) {
+
+    for (arma::uword j = 0; j < Packed.n_cols; j++) {
+
+      for (arma::uword i = 0; i < Packed.n_rows; i++) {
+
+        Out(i, j, s) = Packed.Get(i, j, Slices[s] - 1);
+
+      }
+
+    }
+
+  }
+
+  // Return decoded slices
+  return Out;
+
+}
+
+
+// Decode the posterior samples of entry (Row, Col) across all the slices, Row and Col are 1 based
+// [[Rcpp::export]]
+arma::colvec Edge_Pst_cpp(const Rcpp::RawVector& Pst, int Row, int Col) {
+
+  // View the packed posterior samples
+  Packed_View Packed(Pst);
+
+  // Decode the entry of every slice
+  arma::colvec Out(Packed.n_slices);
+
+  for (arma::uword s = 0; s < Packed.n_slices; s++) {
+
+    Out(s) = Packed.Get(Row - 1, Col - 1, s);
+
+  }
+
+  // Return the series of the entry
+  return Out;
+
+}
+
+
+
+// Create a builder of the summary level data for p response variables and k instrument variables
+// [[Rcpp::export]]
+SEXP Gram_Create_cpp(int p, int k) {
+
+  return Rcpp::XPtr<Gram_Builder>(new Gram_Builder(p, k), true);
+
+}
+
+
+// Add a chunk of rows of Y and X to a builder of the summary level data
+// [[Rcpp::export]]
+void Gram_Update_cpp(SEXP Builder, const arma::mat& Y, const arma::mat& X) {
+
+  Rcpp::XPtr<Gram_Builder> Gram(Builder);
+
+  Gram->Update(Y, X);
+
+}
+
+
+// Return the summary level data of a builder
+// [[Rcpp::export]]
+Rcpp::List Gram_Result_cpp(SEXP Builder) {
+
+  Rcpp::XPtr<Gram_Builder> Gram(Builder);
+
+  return Gram->Result();
+
+}
+
+
+// Calculate the summary level data from a binary file, reading Chunk_Rows rows at a time
+// [[Rcpp::export]]
+Rcpp::List Binary_Stats_cpp(std::string File, int Chunk_Rows) {
+
+  // Open the file
+  Binary_File Data(File);
+
+  // Add the rows chunk by chunk
+  Gram_Builder Gram(Data.p, Data.k);
+  arma::mat Y, X;
+
+  for (uint64_t Row = 0; Row < Data.n; Row += Chunk_Rows) {
+
+    uint64_t nRow = std::min<uint64_t>(Chunk_Rows, Data.n - Row);
+
+    Data.Read_Rows(0, Data.p, Row, nRow, Y);
+    Data.Read_Rows(Data.p, Data.k, Row, nRow, X);
+
+    Gram.Update(Y, X);
+
+  }
+
+  // Return summary level data
+  return Gram.Result();
+
+}
+
+
+// Calculate the hash of a binary file as 16 hexadecimal digits
+// [[Rcpp::export]]
+std::string Binary_Hash_cpp(std::string File) {
+
+  // Open the file and calculate its hash
+  Binary_File Data(File);
+  uint64_t h = Data.Hash();
+
+  // Format hash
+  char Hex[17];
+  std::snprintf(Hex, sizeof(Hex), "%016llx", (unsigned long long) h);
+
+  return std::string(Hex);
+
+}
+
+
+// Calculate S_YY from the summary level data Beta and Sigma_Hat
+// A is estimated from the cofactors of Beta_New, the p * p matrix of the first instrument column of every response.
+// The ratio of cofactors det(Beta_New[-j, -i]) / det(Beta_New[-i, -i]) equals (-1)^(i + j) Inv(i, j) / Inv(i, i) with
+// Inv = Beta_New^(-1), so all the ratios come from one inverse. The residual sum of squares of Y[, i] on X
+// uses det(R_i) / det(Cor_X) = 1 - r_i' Cor_X^(-1) r_i, the Schur complement of Cor_X in R_i, so all of them come
+// from one factorization of Cor_X
+// [[Rcpp::export]]
+arma::mat Beta_S_YY_cpp(const arma::mat& Beta, const arma::mat& Sigma_Hat, const arma::mat& S_XX, const arma::mat& S_YX, const arma::colvec& d) {
+
+  // Calculate number of response variables
+  int p = Beta.n_rows;
+
+  // Calculate Beta_New matrix by taking the first column of every response from Beta
+  arma::mat Beta_New(p, p);
+  arma::uword Col = 0;
+
+  for (int i = 0; i < p; i++) {
+
+    Beta_New.col(i) = Beta.col(Col);
+    Col += d(i);
+
+  }
+
+  // Calculate inverse of Beta_New
+  arma::mat Inv_Beta;
+
+  if (!arma::inv(Inv_Beta, Beta_New)) {
+
+    Rcpp::stop("Beta matrix at the first instrument of every response should be invertible.");
+
+  }
+
+  // Calculate estimate of A
+  arma::mat A_Est(p, p);
+
+  for (int j = 0; j < p; j++) {
+
+    for (int i = 0; i < p; i++) {
+
+      A_Est(i, j) = (i == j) ? 0 : - Inv_Beta(i, j) / Inv_Beta(i, i);
+
+    }
+
+  }
+
+  // Calculate (I - A_Est)^(-1)
+  arma::mat Mult_Mat = arma::inv(arma::eye(p, p) - A_Est);
+
+  // Calculate diagonal entries of S_YY
+  arma::colvec S_YY_Diag = Sigma_Hat.col(0) + 2 * Beta.col(0) % S_YX.col(0) - arma::square(Beta.col(0)) * S_XX(0, 0);
+
+  // Calculate correlation matrix between X and between Y and X
+  arma::colvec SD_X = arma::sqrt(S_XX.diag());
+  arma::mat Cor_X = S_XX / (SD_X * SD_X.t());
+  arma::mat Cor_YX = (Beta.each_col() / arma::sqrt(S_YY_Diag)).each_row() % SD_X.t();
+
+  // Calculate r_i' Cor_X^(-1) r_i for every response from one factorization of Cor_X
+  arma::mat Solved = arma::solve(Cor_X, Cor_YX.t(), arma::solve_opts::likely_sympd);
+  arma::colvec Explained = arma::sum(Cor_YX.t() % Solved, 0).t();
+
+  // Calculate sum of squares of error while fitting Y[, i] on X
+  arma::colvec Error_Sumsq = S_YY_Diag % (1 - Explained);
+
+  // Calculate Sigma for the model
+  arma::colvec Sigma = arma::solve(arma::square(Mult_Mat), Error_Sumsq);
 
+  // Return S_YY
+  return Beta * S_XX * Beta.t() + Mult_Mat * arma::diagmat(Sigma) * Mult_Mat.t();
 
 }
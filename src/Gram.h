@@ -0,0 +1,65 @@
+#ifndef RGM_GRAM_H
+#define RGM_GRAM_H
+
+#include <RcppArmadillo.h>
+
+
+// Streaming builder of the summary level data S_YY = Y'Y / n, S_YX = Y'X / n and S_XX = X'X / n
+// Rows of Y and X arrive in chunks and every chunk is read once, so the data never has to be resident as a whole.
+// Y'Y and X'X of a chunk are written as A.t() * A, which Armadillo evaluates with a symmetric rank-k update
+// (BLAS syrk) instead of a general product, and no transpose is materialized
+class Gram_Builder {
+
+public:
+
+  // Accumulated cross products and number of rows
+  arma::mat YY, YX, XX;
+  double n;
+
+  // Initialize with p response variables and k instrument variables
+  Gram_Builder(arma::uword p, arma::uword k) : YY(arma::zeros(p, p)), YX(arma::zeros(p, k)), XX(arma::zeros(k, k)), n(0) {}
+
+  // Add a chunk of rows of Y and X, X has no columns when only Y is there
+  void Update(const arma::mat& Y, const arma::mat& X) {
+
+    // Check dimensions of the chunk
+    if (Y.n_cols != YY.n_cols || X.n_cols != XX.n_cols || (X.n_cols > 0 && X.n_rows != Y.n_rows)) {
+
+      Rcpp::stop("Dimensions of the chunk do not match the previous chunks.");
+
+    }
+
+    // Accumulate cross products
+    YY += Y.t() * Y;
+
+    if (X.n_cols > 0) {
+
+      YX += Y.t() * X;
+      XX += X.t() * X;
+
+    }
+
+    // Update number of rows
+    n += Y.n_rows;
+
+  }
+
+  // Return S_YY, S_YX, S_XX and number of datapoints
+  Rcpp::List Result() const {
+
+    // Check number of rows
+    if (n == 0) {
+
+      Rcpp::stop("No rows of data were given.");
+
+    }
+
+    return Rcpp::List::create(Rcpp::Named("S_YY") = YY / n, Rcpp::Named("S_YX") = YX / n,
+                              Rcpp::Named("S_XX") = XX / n, Rcpp::Named("n") = n);
+
+  }
+
+};
+
+
+#endif
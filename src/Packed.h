@@ -0,0 +1,427 @@
+#ifndef RGM_PACKED_H
+#define RGM_PACKED_H
+
+#include <RcppArmadillo.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+
+// Count the set bits of a word
+inline int Popcount(uint64_t x) {
+
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(x);
+#else
+  int Count = 0;
+
+  for (; x != 0; x &= x - 1) {
+
+    Count++;
+
+  }
+
+  return Count;
+#endif
+
+}
+
+
+// Posterior samples of a 0 / 1 array packed into bits
+// Slice s holds entry (i, j) at bit i + j * n_rows of its own run of 64 bit words, so every slice starts on a
+// word boundary. In R the array is a raw vector of class "RGM_Packed" with the dimensions in attribute "Dims",
+// where byte b of word w is byte 8 * w + b and bits are numbered from the least significant bit
+class Packed_Array {
+
+public:
+
+  // Dimensions and number of words per slice
+  arma::uword n_rows, n_cols, n_slices, n_words;
+
+  // Packed bits
+  std::vector<uint64_t> Words;
+
+  // Initialize an empty array
+  Packed_Array() : n_rows(0), n_cols(0), n_slices(0), n_words(0) {}
+
+  // Initialize an array of zeros
+  Packed_Array(arma::uword n_rows, arma::uword n_cols, arma::uword n_slices) :
+    n_rows(n_rows), n_cols(n_cols), n_slices(n_slices), n_words((n_rows * n_cols + 63) / 64),
+    Words(n_words * n_slices, 0) {}
+
+  // Pack the column major entries x into slice s, entries equal to 1 are set
+  void Set_Slice(arma::uword s, const double* x) {
+
+    uint64_t* Slice = &Words[s * n_words];
+
+    for (arma::uword l = 0; l < n_rows * n_cols; l++) {
+
+      if (x[l] == 1) {
+
+        Slice[l / 64] |= (uint64_t) 1 << (l % 64);
+
+      }
+
+    }
+
+  }
+
+  // Pack matrix x into slice s
+  void Set_Slice(arma::uword s, const arma::mat& x) {
+
+    Set_Slice(s, x.memptr());
+
+  }
+
+  // Return word w of slice s
+  uint64_t Word(arma::uword s, arma::uword w) const {
+
+    return Words[s * n_words + w];
+
+  }
+
+  // Return entry (i, j) of slice s
+  bool Get(arma::uword i, arma::uword j, arma::uword s) const {
+
+    arma::uword l = i + j * n_rows;
+
+    return (Words[s * n_words + l / 64] >> (l % 64)) & 1;
+
+  }
+
+  // Save or restore the dimensions and the first n_used slices, a restored array has n_slices slices
+  template <typename Archive>
+  void Serialize(Archive& Ar, arma::uword n_used, arma::uword n_slices) {
+
+    uint64_t Dims[2] = {n_rows, n_cols};
+
+    Ar.Value(Dims[0]);
+    Ar.Value(Dims[1]);
+
+    if (Ar.Reading) {
+
+      *this = Packed_Array(Dims[0], Dims[1], n_slices);
+
+    }
+
+    Ar.Bytes(Words.data(), n_words * n_used * sizeof(uint64_t));
+
+  }
+
+  // Keep only the first n slices
+  void Truncate(arma::uword n) {
+
+    if (n < n_slices) {
+
+      n_slices = n;
+      Words.resize(n_words * n_slices);
+
+    }
+
+  }
+
+};
+
+
+// Read-only view of packed posterior samples in their R representation
+// Entries and words are decoded from the bytes on demand, so nothing is copied
+class Packed_View {
+
+public:
+
+  // Dimensions and number of words per slice
+  arma::uword n_rows, n_cols, n_slices, n_words;
+
+  // Initialize view and check the length of the raw vector
+  explicit Packed_View(const Rcpp::RawVector& Pst) : Bytes(RAW(Pst)) {
+
+    // Read dimensions
+    Rcpp::IntegerVector Dims = Pst.attr("Dims");
+
+    n_rows = Dims[0];
+    n_cols = Dims[1];
+    n_slices = Dims[2];
+    n_words = (n_rows * n_cols + 63) / 64;
+
+    // Check length
+    if ((arma::uword) Pst.size() != 8 * n_words * n_slices) {
+
+      Rcpp::stop("Length of the packed array does not match its dimensions.");
+
+    }
+
+  }
+
+  // Return word w of slice s
+  uint64_t Word(arma::uword s, arma::uword w) const {
+
+    const unsigned char* Word_Bytes = Bytes + 8 * (s * n_words + w);
+    uint64_t x = 0;
+
+    for (int b = 0; b < 8; b++) {
+
+      x |= (uint64_t) Word_Bytes[b] << (8 * b);
+
+    }
+
+    return x;
+
+  }
+
+  // Return entry l in column major order of slice s
+  bool Get_Index(arma::uword l, arma::uword s) const {
+
+    return (Bytes[8 * s * n_words + l / 8] >> (l % 8)) & 1;
+
+  }
+
+  // Return entry (i, j) of slice s
+  bool Get(arma::uword i, arma::uword j, arma::uword s) const {
+
+    return Get_Index(i + j * n_rows, s);
+
+  }
+
+private:
+
+  // Bytes of the raw vector
+  const unsigned char* Bytes;
+
+};
+
+
+// Read-only view of posterior samples in a cube with the interface of Packed_View, entries equal to 1 are set
+class Dense_View {
+
+public:
+
+  // Dimensions
+  arma::uword n_rows, n_cols, n_slices;
+
+  // Initialize view
+  explicit Dense_View(const arma::cube& X) : n_rows(X.n_rows), n_cols(X.n_cols), n_slices(X.n_slices), X(X) {}
+
+  // Return entry l in column major order of slice s
+  bool Get_Index(arma::uword l, arma::uword s) const {
+
+    return X.slice_memptr(s)[l] == 1;
+
+  }
+
+private:
+
+  // Posterior samples
+  const arma::cube& X;
+
+};
+
+
+// Pack every slice of a cube of 0 / 1 entries on nThreads threads
+inline Packed_Array Pack_Cube(const arma::cube& x, int nThreads) {
+
+  Packed_Array Packed(x.n_rows, x.n_cols, x.n_slices);
+
+  // Slices occupy separate words, so they can be packed in parallel
+#pragma omp parallel for num_threads(nThreads) schedule(static)
+  for (int s = 0; s < (int) x.n_slices; s++) {
+
+    Packed.Set_Slice(s, x.slice_memptr(s));
+
+  }
+
+  return Packed;
+
+}
+
+
+// Count the posterior samples that contain each motif in a single pass over the posterior
+// Sample s contains motif m if (Mask_m & ~Sample_s) == 0 for every word. The slices are split across nThreads
+// threads and every word of a slice is read once for all the motifs
+template <typename Packed_Type>
+arma::colvec Count_Motifs(const Packed_Type& Pst, const Packed_Array& Masks, int nThreads) {
+
+  // Calculate number of motifs and number of words per slice
+  int nMotif = Masks.n_slices;
+  arma::uword n_words = Pst.n_words;
+
+  // Initialize counts
+  arma::colvec Count = arma::zeros(nMotif);
+
+#pragma omp parallel num_threads(nThreads)
+  {
+
+    // Counts of this thread and words of the current slice
+    std::vector<double> Local_Count(nMotif, 0);
+    std::vector<uint64_t> Slice(n_words);
+
+#pragma omp for schedule(static)
+    for (int s = 0; s < (int) Pst.n_slices; s++) {
+
+      // Read words of the slice
+      for (arma::uword w = 0; w < n_words; w++) {
+
+        Slice[w] = Pst.Word(s, w);
+
+      }
+
+      // Test every motif
+      for (int m = 0; m < nMotif; m++) {
+
+        const uint64_t* Mask = &Masks.Words[m * n_words];
+        uint64_t Missing = 0;
+
+        for (arma::uword w = 0; w < n_words; w++) {
+
+          Missing |= Mask[w] & ~Slice[w];
+
+        }
+
+        Local_Count[m] += (Missing == 0);
+
+      }
+
+    }
+
+    // Add counts of this thread
+#pragma omp critical
+    for (int m = 0; m < nMotif; m++) {
+
+      Count(m) += Local_Count[m];
+
+    }
+
+  }
+
+  // Return counts
+  return Count;
+
+}
+
+
+// Count the posterior samples that contain each motif given as a list of edges
+// Motif[e] is the motif of edge e and Index[e] its column major index. The posterior is read once to build an
+// inverted index holding, for every distinct edge, a bitset of the samples that contain it. The count of a motif
+// is then the number of bits set in the AND of the bitsets of its edges. Both steps run on nThreads threads
+template <typename View_Type>
+arma::colvec Count_Motif_Edges(const View_Type& Pst, const std::vector<int>& Motif, const std::vector<arma::uword>& Index, int nMotif, int nThreads) {
+
+  // Find the distinct edges
+  std::vector<arma::uword> Edges = Index;
+  std::sort(Edges.begin(), Edges.end());
+  Edges.erase(std::unique(Edges.begin(), Edges.end()), Edges.end());
+
+  // Calculate number of distinct edges and number of words of a bitset over the samples
+  int nEdge = Edges.size();
+  int nBlock = (Pst.n_slices + 63) / 64;
+
+  // Build the bitsets, every thread fills whole words so no two threads write the same word
+  std::vector<uint64_t> Edge_Bits((size_t) nEdge * nBlock, 0);
+
+#pragma omp parallel for num_threads(nThreads) schedule(static)
+  for (int b = 0; b < nBlock; b++) {
+
+    arma::uword Last = std::min<arma::uword>(64 * (b + 1), Pst.n_slices);
+
+    for (arma::uword s = 64 * b; s < Last; s++) {
+
+      for (int e = 0; e < nEdge; e++) {
+
+        if (Pst.Get_Index(Edges[e], s)) {
+
+          Edge_Bits[(size_t) e * nBlock + b] |= (uint64_t) 1 << (s % 64);
+
+        }
+
+      }
+
+    }
+
+  }
+
+  // Collect the distinct edges of every motif
+  std::vector<std::vector<int> > Motif_Edges(nMotif);
+
+  for (size_t e = 0; e < Index.size(); e++) {
+
+    Motif_Edges[Motif[e]].push_back(std::lower_bound(Edges.begin(), Edges.end(), Index[e]) - Edges.begin());
+
+  }
+
+  // Count the samples containing every edge of each motif, a motif without edges is in every sample
+  arma::colvec Count(nMotif);
+
+#pragma omp parallel for num_threads(nThreads) schedule(dynamic)
+  for (int m = 0; m < nMotif; m++) {
+
+    const std::vector<int>& Own = Motif_Edges[m];
+    double Total = 0;
+
+    for (int b = 0; b < nBlock; b++) {
+
+      // Start from the samples of this block
+      uint64_t Word = (64 * (b + 1) <= (int) Pst.n_slices) ? ~(uint64_t) 0 : ((uint64_t) 1 << (Pst.n_slices % 64)) - 1;
+
+      for (size_t e = 0; e < Own.size() && Word != 0; e++) {
+
+        Word &= Edge_Bits[(size_t) Own[e] * nBlock + b];
+
+      }
+
+      Total += Popcount(Word);
+
+    }
+
+    Count(m) = Total;
+
+  }
+
+  // Return counts
+  return Count;
+
+}
+
+
+// Convert the packed samples of all the chains to a single R array, stacking the slices chain by chain
+inline Rcpp::RawVector Wrap_Packed(const std::vector<const Packed_Array*>& Chains) {
+
+  // Calculate dimensions
+  const Packed_Array& First = *Chains[0];
+  arma::uword n_slices = 0;
+
+  for (size_t c = 0; c < Chains.size(); c++) {
+
+    n_slices += Chains[c]->n_slices;
+
+  }
+
+  // Split words into bytes
+  Rcpp::RawVector Pst(8 * First.n_words * n_slices);
+  size_t Offset = 0;
+
+  for (size_t c = 0; c < Chains.size(); c++) {
+
+    for (size_t w = 0; w < Chains[c]->Words.size(); w++) {
+
+      for (int b = 0; b < 8; b++) {
+
+        Pst[Offset + 8 * w + b] = (Chains[c]->Words[w] >> (8 * b)) & 0xFF;
+
+      }
+
+    }
+
+    Offset += 8 * Chains[c]->Words.size();
+
+  }
+
+  // Set dimensions and class
+  Pst.attr("Dims") = Rcpp::IntegerVector::create(First.n_rows, First.n_cols, n_slices);
+  Pst.attr("class") = "RGM_Packed";
+
+  // Return packed array
+  return Pst;
+
+}
+
+
+#endif
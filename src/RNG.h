@@ -0,0 +1,305 @@
+#ifndef RGM_RNG_H
+#define RGM_RNG_H
+
+#include <RcppArmadillo.h>
+#include <cmath>
+#include <cstdint>
+
+
+// Counter-based random number generator (Philox4x32-10)
+// A generator is identified by a 64 bit key and a 64 bit stream number. Its output is a pure function
+// of (key, stream, counter), so independent streams are obtained without jump-ahead and a draw does
+// not depend on which thread runs it. No draw allocates memory or touches R's RNG.
+class RGM_RNG {
+
+public:
+
+  // Initialize generator with a key and a stream number
+  explicit RGM_RNG(uint64_t Seed, uint64_t Stream = 0) : Key(Seed), Stream_ID(Stream), Counter(0), Index(4), Has_Spare(false), Spare(0) {}
+
+  // Return an independent generator with the same key and another stream number
+  RGM_RNG Split(uint64_t Stream) const {
+
+    return RGM_RNG(Key, Stream);
+
+  }
+
+  // Return the next 32 bit random integer
+  uint32_t Next() {
+
+    // Generate a new block of four integers when the current block is used up
+    if (Index == 4) {
+
+      Generate();
+      Index = 0;
+
+    }
+
+    // Return next integer of the block
+    return Block[Index++];
+
+  }
+
+  // Return the next 64 bit random integer, for example as the key of another generator
+  uint64_t Next64() {
+
+    uint64_t Upper = Next();
+
+    return (Upper << 32) | Next();
+
+  }
+
+  // Sample from Uniform(0, 1), never returns 0 or 1
+  double Uniform() {
+
+    // Use 52 random bits, so that k + 0.5 is exact and the largest value, 1 - 2^(-53), stays below 1
+    uint64_t Upper = Next() >> 6;
+    uint64_t Lower = Next() >> 6;
+    uint64_t k = (Upper << 26) | Lower;
+
+    // Return value in the open interval (0, 1)
+    return (k + 0.5) / 4503599627370496.0;
+
+  }
+
+  // Fill x with n samples from Uniform(0, 1)
+  void Fill_Uniform(double* x, size_t n) {
+
+    for (size_t l = 0; l < n; l++) {
+
+      x[l] = Uniform();
+
+    }
+
+  }
+
+  // Sample from Uniform(a, b)
+  double Uniform(double a, double b) {
+
+    return a + (b - a) * Uniform();
+
+  }
+
+  // Sample from Normal(0, 1) using the polar method
+  double Normal() {
+
+    // Use the spare value of the previous pair if there is one
+    if (Has_Spare) {
+
+      Has_Spare = false;
+      return Spare;
+
+    }
+
+    // Sample a point uniformly inside the unit circle
+    double u, v, s;
+
+    do {
+
+      u = 2 * Uniform() - 1;
+      v = 2 * Uniform() - 1;
+      s = u * u + v * v;
+
+    } while (s >= 1 || s == 0);
+
+    // Transform the point into a pair of independent standard normals
+    double Mult = std::sqrt(-2 * std::log(s) / s);
+
+    Spare = v * Mult;
+    Has_Spare = true;
+
+    // Return x
+    return u * Mult;
+
+  }
+
+  // Sample from Normal(mu, sigma^2)
+  double Normal(double mu, double sigma) {
+
+    return mu + sigma * Normal();
+
+  }
+
+  // Sample from Gamma with shape and scale parameters using Marsaglia and Tsang's method
+  double Gamma(double shape, double scale) {
+
+    // Boost shape below 1 with Gamma(shape) = Gamma(shape + 1) * U^(1 / shape)
+    if (shape < 1) {
+
+      double u = Uniform();
+      return Gamma(shape + 1, scale) * std::pow(u, 1 / shape);
+
+    }
+
+    // Calculate constants
+    double d = shape - 1.0 / 3;
+    double c = 1 / std::sqrt(9 * d);
+
+    // Propose until acceptance
+    while (true) {
+
+      double x, v;
+
+      do {
+
+        x = Normal(0, 1);
+        v = 1 + c * x;
+
+      } while (v <= 0);
+
+      v = v * v * v;
+      double u = Uniform();
+
+      // Squeeze test, then exact test
+      if (u < 1 - 0.0331 * x * x * x * x || std::log(u) < 0.5 * x * x + d * (1 - v + std::log(v))) {
+
+        return d * v * scale;
+
+      }
+
+    }
+
+  }
+
+  // Sample from Beta(a, b) as a ratio of gamma random numbers
+  double Beta(double a, double b) {
+
+    double x = Gamma(a, 1);
+    double y = Gamma(b, 1);
+
+    return x / (x + y);
+
+  }
+
+  // Sample from Bernoulli(prob)
+  double Bernoulli(double prob) {
+
+    return (Uniform() < prob) * 1.0;
+
+  }
+
+  // Sample from Normal(mu, sigma^2) truncated to (a, b) by inversion
+  double Truncated_Normal(double mu, double sigma, double a, double b) {
+
+    // Calculate alpha and beta
+    double alpha = (a - mu) / sigma;
+    double beta = (b - mu) / sigma;
+
+    // Work in the lower tail, where the normal CDF is accurate
+    bool Flip = alpha > 0;
+
+    if (Flip) {
+
+      double Temp = alpha;
+      alpha = -beta;
+      beta = -Temp;
+
+    }
+
+    // Calculate CDF
+    double cdf_alpha = R::pnorm(alpha, 0.0, 1.0, true, false);
+    double cdf_beta = R::pnorm(beta, 0.0, 1.0, true, false);
+
+    // Sample from the truncated standard normal
+    double z = R::qnorm(cdf_alpha + (cdf_beta - cdf_alpha) * Uniform(), 0.0, 1.0, true, false);
+
+    // Keep z inside the interval when the CDF can not resolve it
+    z = std::min(std::max(z, alpha), beta);
+
+    // Return x
+    return mu + sigma * (Flip ? -z : z);
+
+  }
+
+  // Save or restore the complete state, so a restored generator continues with the same draws
+  template <typename Archive>
+  void Serialize(Archive& Ar) {
+
+    Ar.Value(Key);
+    Ar.Value(Stream_ID);
+    Ar.Value(Counter);
+
+    for (int b = 0; b < 4; b++) {
+
+      Ar.Value(Block[b]);
+
+    }
+
+    Ar.Value(Index);
+    Ar.Value(Has_Spare);
+    Ar.Value(Spare);
+
+  }
+
+private:
+
+  // Key, stream number and block counter
+  uint64_t Key;
+  uint64_t Stream_ID;
+  uint64_t Counter;
+
+  // Current block of random integers and position within it
+  uint32_t Block[4];
+  int Index;
+
+  // Spare standard normal of the polar method
+  bool Has_Spare;
+  double Spare;
+
+  // Generate the block of the current counter and advance the counter
+  void Generate() {
+
+    // Constants of Philox4x32
+    const uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+    const uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+
+    // Initialize counter words and key words
+    uint32_t c0 = (uint32_t) Counter, c1 = (uint32_t) (Counter >> 32);
+    uint32_t c2 = (uint32_t) Stream_ID, c3 = (uint32_t) (Stream_ID >> 32);
+    uint32_t k0 = (uint32_t) Key, k1 = (uint32_t) (Key >> 32);
+
+    // Apply 10 rounds
+    for (int r = 0; r < 10; r++) {
+
+      uint64_t Prod0 = (uint64_t) M0 * c0;
+      uint64_t Prod1 = (uint64_t) M1 * c2;
+
+      uint32_t Hi0 = (uint32_t) (Prod0 >> 32), Lo0 = (uint32_t) Prod0;
+      uint32_t Hi1 = (uint32_t) (Prod1 >> 32), Lo1 = (uint32_t) Prod1;
+
+      c0 = Hi1 ^ c1 ^ k0;
+      c1 = Lo1;
+      c2 = Hi0 ^ c3 ^ k1;
+      c3 = Lo0;
+
+      k0 += W0;
+      k1 += W1;
+
+    }
+
+    // Store block
+    Block[0] = c0; Block[1] = c1; Block[2] = c2; Block[3] = c3;
+
+    // Advance counter
+    Counter++;
+
+  }
+
+};
+
+
+// Draw a seed from R's RNG
+// This must be called from the main thread
+inline uint64_t Draw_Seed() {
+
+  // Combine two 32 bit draws
+  uint64_t Upper = (uint64_t) std::floor(R::unif_rand() * 4294967296.0);
+  uint64_t Lower = (uint64_t) std::floor(R::unif_rand() * 4294967296.0);
+
+  // Return seed
+  return (Upper << 32) | Lower;
+
+}
+
+
+#endif
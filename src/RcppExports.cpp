@@ -11,102 +11,6 @@ Rcpp::Rostream<true>&  Rcpp::Rcout = Rcpp::Rcpp_cout_get();
 Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
 #endif
 
-// Sample_Rho
-double Sample_Rho(double Gamma, double a_rho, double b_rho);
-RcppExport SEXP _MR_RGM_Sample_Rho(SEXP GammaSEXP, SEXP a_rhoSEXP, SEXP b_rhoSEXP) {
-BEGIN_RCPP
-    Rcpp::RObject rcpp_result_gen;
-    Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< double >::type Gamma(GammaSEXP);
-    Rcpp::traits::input_parameter< double >::type a_rho(a_rhoSEXP);
-    Rcpp::traits::input_parameter< double >::type b_rho(b_rhoSEXP);
-    rcpp_result_gen = Rcpp::wrap(Sample_Rho(Gamma, a_rho, b_rho));
-    return rcpp_result_gen;
-END_RCPP
-}
-// Sample_Psi
-double Sample_Psi(double Phi, double a_psi, double b_psi);
-RcppExport SEXP _MR_RGM_Sample_Psi(SEXP PhiSEXP, SEXP a_psiSEXP, SEXP b_psiSEXP) {
-BEGIN_RCPP
-    Rcpp::RObject rcpp_result_gen;
-    Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< double >::type Phi(PhiSEXP);
-    Rcpp::traits::input_parameter< double >::type a_psi(a_psiSEXP);
-    Rcpp::traits::input_parameter< double >::type b_psi(b_psiSEXP);
-    rcpp_result_gen = Rcpp::wrap(Sample_Psi(Phi, a_psi, b_psi));
-    return rcpp_result_gen;
-END_RCPP
-}
-// Sample_Tau
-double Sample_Tau(double a, double gamma, double tau, double nu_1);
-RcppExport SEXP _MR_RGM_Sample_Tau(SEXP aSEXP, SEXP gammaSEXP, SEXP tauSEXP, SEXP nu_1SEXP) {
-BEGIN_RCPP
-    Rcpp::RObject rcpp_result_gen;
-    Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< double >::type a(aSEXP);
-    Rcpp::traits::input_parameter< double >::type gamma(gammaSEXP);
-    Rcpp::traits::input_parameter< double >::type tau(tauSEXP);
-    Rcpp::traits::input_parameter< double >::type nu_1(nu_1SEXP);
-    rcpp_result_gen = Rcpp::wrap(Sample_Tau(a, gamma, tau, nu_1));
-    return rcpp_result_gen;
-END_RCPP
-}
-// Sample_Eta
-double Sample_Eta(double b, double phi, double eta, double nu_2);
-RcppExport SEXP _MR_RGM_Sample_Eta(SEXP bSEXP, SEXP phiSEXP, SEXP etaSEXP, SEXP nu_2SEXP) {
-BEGIN_RCPP
-    Rcpp::RObject rcpp_result_gen;
-    Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< double >::type b(bSEXP);
-    Rcpp::traits::input_parameter< double >::type phi(phiSEXP);
-    Rcpp::traits::input_parameter< double >::type eta(etaSEXP);
-    Rcpp::traits::input_parameter< double >::type nu_2(nu_2SEXP);
-    rcpp_result_gen = Rcpp::wrap(Sample_Eta(b, phi, eta, nu_2));
-    return rcpp_result_gen;
-END_RCPP
-}
-// Sample_Gamma
-double Sample_Gamma(double a, double tau, double rho, double nu_1);
-RcppExport SEXP _MR_RGM_Sample_Gamma(SEXP aSEXP, SEXP tauSEXP, SEXP rhoSEXP, SEXP nu_1SEXP) {
-BEGIN_RCPP
-    Rcpp::RObject rcpp_result_gen;
-    Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< double >::type a(aSEXP);
-    Rcpp::traits::input_parameter< double >::type tau(tauSEXP);
-    Rcpp::traits::input_parameter< double >::type rho(rhoSEXP);
-    Rcpp::traits::input_parameter< double >::type nu_1(nu_1SEXP);
-    rcpp_result_gen = Rcpp::wrap(Sample_Gamma(a, tau, rho, nu_1));
-    return rcpp_result_gen;
-END_RCPP
-}
-// Sample_Phi
-double Sample_Phi(double b, double eta, double psi, double nu_2);
-RcppExport SEXP _MR_RGM_Sample_Phi(SEXP bSEXP, SEXP etaSEXP, SEXP psiSEXP, SEXP nu_2SEXP) {
-BEGIN_RCPP
-    Rcpp::RObject rcpp_result_gen;
-    Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< double >::type b(bSEXP);
-    Rcpp::traits::input_parameter< double >::type eta(etaSEXP);
-    Rcpp::traits::input_parameter< double >::type psi(psiSEXP);
-    Rcpp::traits::input_parameter< double >::type nu_2(nu_2SEXP);
-    rcpp_result_gen = Rcpp::wrap(Sample_Phi(b, eta, psi, nu_2));
-    return rcpp_result_gen;
-END_RCPP
-}
-// Sample_Sigma
-double Sample_Sigma(double n, double z_sum, double a_sigma, double b_sigma);
-RcppExport SEXP _MR_RGM_Sample_Sigma(SEXP nSEXP, SEXP z_sumSEXP, SEXP a_sigmaSEXP, SEXP b_sigmaSEXP) {
-BEGIN_RCPP
-    Rcpp::RObject rcpp_result_gen;
-    Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< double >::type n(nSEXP);
-    Rcpp::traits::input_parameter< double >::type z_sum(z_sumSEXP);
-    Rcpp::traits::input_parameter< double >::type a_sigma(a_sigmaSEXP);
-    Rcpp::traits::input_parameter< double >::type b_sigma(b_sigmaSEXP);
-    rcpp_result_gen = Rcpp::wrap(Sample_Sigma(n, z_sum, a_sigma, b_sigma));
-    return rcpp_result_gen;
-END_RCPP
-}
 // Target_A
 double Target_A(double a, double N, double gamma, double tau, double nu_1, double Trace3, double Trace4, double Trace5, double Trace6, double logdet);
 RcppExport SEXP _MR_RGM_Target_A(SEXP aSEXP, SEXP NSEXP, SEXP gammaSEXP, SEXP tauSEXP, SEXP nu_1SEXP, SEXP Trace3SEXP, SEXP Trace4SEXP, SEXP Trace5SEXP, SEXP Trace6SEXP, SEXP logdetSEXP) {
@@ -127,37 +31,6 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
-// Sample_A
-Rcpp::List Sample_A(const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& A, const arma::mat& A_Pseudo, double i, double j, const arma::colvec& Sigma_Inv, double N, double p, const arma::mat& B, double gamma, double tau, double nu_1, double prop_var1, double tA, double Trace3, double Trace4, double Trace5, double Trace6, arma::mat InvMat, double logdet);
-RcppExport SEXP _MR_RGM_Sample_A(SEXP S_YYSEXP, SEXP S_YXSEXP, SEXP ASEXP, SEXP A_PseudoSEXP, SEXP iSEXP, SEXP jSEXP, SEXP Sigma_InvSEXP, SEXP NSEXP, SEXP pSEXP, SEXP BSEXP, SEXP gammaSEXP, SEXP tauSEXP, SEXP nu_1SEXP, SEXP prop_var1SEXP, SEXP tASEXP, SEXP Trace3SEXP, SEXP Trace4SEXP, SEXP Trace5SEXP, SEXP Trace6SEXP, SEXP InvMatSEXP, SEXP logdetSEXP) {
-BEGIN_RCPP
-    Rcpp::RObject rcpp_result_gen;
-    Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< const arma::mat& >::type S_YY(S_YYSEXP);
-    Rcpp::traits::input_parameter< const arma::mat& >::type S_YX(S_YXSEXP);
-    Rcpp::traits::input_parameter< const arma::mat& >::type A(ASEXP);
-    Rcpp::traits::input_parameter< const arma::mat& >::type A_Pseudo(A_PseudoSEXP);
-    Rcpp::traits::input_parameter< double >::type i(iSEXP);
-    Rcpp::traits::input_parameter< double >::type j(jSEXP);
-    Rcpp::traits::input_parameter< const arma::colvec& >::type Sigma_Inv(Sigma_InvSEXP);
-    Rcpp::traits::input_parameter< double >::type N(NSEXP);
-    Rcpp::traits::input_parameter< double >::type p(pSEXP);
-    Rcpp::traits::input_parameter< const arma::mat& >::type B(BSEXP);
-    Rcpp::traits::input_parameter< double >::type gamma(gammaSEXP);
-    Rcpp::traits::input_parameter< double >::type tau(tauSEXP);
-    Rcpp::traits::input_parameter< double >::type nu_1(nu_1SEXP);
-    Rcpp::traits::input_parameter< double >::type prop_var1(prop_var1SEXP);
-    Rcpp::traits::input_parameter< double >::type tA(tASEXP);
-    Rcpp::traits::input_parameter< double >::type Trace3(Trace3SEXP);
-    Rcpp::traits::input_parameter< double >::type Trace4(Trace4SEXP);
-    Rcpp::traits::input_parameter< double >::type Trace5(Trace5SEXP);
-    Rcpp::traits::input_parameter< double >::type Trace6(Trace6SEXP);
-    Rcpp::traits::input_parameter< arma::mat >::type InvMat(InvMatSEXP);
-    Rcpp::traits::input_parameter< double >::type logdet(logdetSEXP);
-    rcpp_result_gen = Rcpp::wrap(Sample_A(S_YY, S_YX, A, A_Pseudo, i, j, Sigma_Inv, N, p, B, gamma, tau, nu_1, prop_var1, tA, Trace3, Trace4, Trace5, Trace6, InvMat, logdet));
-    return rcpp_result_gen;
-END_RCPP
-}
 // Target_B
 double Target_B(double b, double phi, double eta, double nu_2, double Trace1, double Trace2);
 RcppExport SEXP _MR_RGM_Target_B(SEXP bSEXP, SEXP phiSEXP, SEXP etaSEXP, SEXP nu_2SEXP, SEXP Trace1SEXP, SEXP Trace2SEXP) {
@@ -174,79 +47,6 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
-// Sample_B
-Rcpp::List Sample_B(const arma::mat& S_YX, const arma::mat& S_XX, const arma::mat& B, const arma::mat& B_Pseudo, double i, double j, const arma::colvec& Sigma_Inv, const arma::mat& MultMat, double N, double phi, double eta, double nu_2, double prop_var2, double tB, double Trace1, double Trace2);
-RcppExport SEXP _MR_RGM_Sample_B(SEXP S_YXSEXP, SEXP S_XXSEXP, SEXP BSEXP, SEXP B_PseudoSEXP, SEXP iSEXP, SEXP jSEXP, SEXP Sigma_InvSEXP, SEXP MultMatSEXP, SEXP NSEXP, SEXP phiSEXP, SEXP etaSEXP, SEXP nu_2SEXP, SEXP prop_var2SEXP, SEXP tBSEXP, SEXP Trace1SEXP, SEXP Trace2SEXP) {
-BEGIN_RCPP
-    Rcpp::RObject rcpp_result_gen;
-    Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< const arma::mat& >::type S_YX(S_YXSEXP);
-    Rcpp::traits::input_parameter< const arma::mat& >::type S_XX(S_XXSEXP);
-    Rcpp::traits::input_parameter< const arma::mat& >::type B(BSEXP);
-    Rcpp::traits::input_parameter< const arma::mat& >::type B_Pseudo(B_PseudoSEXP);
-    Rcpp::traits::input_parameter< double >::type i(iSEXP);
-    Rcpp::traits::input_parameter< double >::type j(jSEXP);
-    Rcpp::traits::input_parameter< const arma::colvec& >::type Sigma_Inv(Sigma_InvSEXP);
-    Rcpp::traits::input_parameter< const arma::mat& >::type MultMat(MultMatSEXP);
-    Rcpp::traits::input_parameter< double >::type N(NSEXP);
-    Rcpp::traits::input_parameter< double >::type phi(phiSEXP);
-    Rcpp::traits::input_parameter< double >::type eta(etaSEXP);
-    Rcpp::traits::input_parameter< double >::type nu_2(nu_2SEXP);
-    Rcpp::traits::input_parameter< double >::type prop_var2(prop_var2SEXP);
-    Rcpp::traits::input_parameter< double >::type tB(tBSEXP);
-    Rcpp::traits::input_parameter< double >::type Trace1(Trace1SEXP);
-    Rcpp::traits::input_parameter< double >::type Trace2(Trace2SEXP);
-    rcpp_result_gen = Rcpp::wrap(Sample_B(S_YX, S_XX, B, B_Pseudo, i, j, Sigma_Inv, MultMat, N, phi, eta, nu_2, prop_var2, tB, Trace1, Trace2));
-    return rcpp_result_gen;
-END_RCPP
-}
-// Target_A_Star
-double Target_A_Star(double a, double N, double gamma, double tau, double nu_1, double Trace3, double Trace4, double Trace5, double logdet);
-RcppExport SEXP _MR_RGM_Target_A_Star(SEXP aSEXP, SEXP NSEXP, SEXP gammaSEXP, SEXP tauSEXP, SEXP nu_1SEXP, SEXP Trace3SEXP, SEXP Trace4SEXP, SEXP Trace5SEXP, SEXP logdetSEXP) {
-BEGIN_RCPP
-    Rcpp::RObject rcpp_result_gen;
-    Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< double >::type a(aSEXP);
-    Rcpp::traits::input_parameter< double >::type N(NSEXP);
-    Rcpp::traits::input_parameter< double >::type gamma(gammaSEXP);
-    Rcpp::traits::input_parameter< double >::type tau(tauSEXP);
-    Rcpp::traits::input_parameter< double >::type nu_1(nu_1SEXP);
-    Rcpp::traits::input_parameter< double >::type Trace3(Trace3SEXP);
-    Rcpp::traits::input_parameter< double >::type Trace4(Trace4SEXP);
-    Rcpp::traits::input_parameter< double >::type Trace5(Trace5SEXP);
-    Rcpp::traits::input_parameter< double >::type logdet(logdetSEXP);
-    rcpp_result_gen = Rcpp::wrap(Target_A_Star(a, N, gamma, tau, nu_1, Trace3, Trace4, Trace5, logdet));
-    return rcpp_result_gen;
-END_RCPP
-}
-// Sample_A_Star
-Rcpp::List Sample_A_Star(const arma::mat& S_YY, const arma::mat& A, const arma::mat& A_Pseudo, double i, double j, const arma::colvec& Sigma_Inv, double N, double p, double gamma, double tau, double nu_1, double prop_var1, double tA, double Trace3, double Trace4, double Trace5, arma::mat InvMat, double logdet);
-RcppExport SEXP _MR_RGM_Sample_A_Star(SEXP S_YYSEXP, SEXP ASEXP, SEXP A_PseudoSEXP, SEXP iSEXP, SEXP jSEXP, SEXP Sigma_InvSEXP, SEXP NSEXP, SEXP pSEXP, SEXP gammaSEXP, SEXP tauSEXP, SEXP nu_1SEXP, SEXP prop_var1SEXP, SEXP tASEXP, SEXP Trace3SEXP, SEXP Trace4SEXP, SEXP Trace5SEXP, SEXP InvMatSEXP, SEXP logdetSEXP) {
-BEGIN_RCPP
-    Rcpp::RObject rcpp_result_gen;
-    Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< const arma::mat& >::type S_YY(S_YYSEXP);
-    Rcpp::traits::input_parameter< const arma::mat& >::type A(ASEXP);
-    Rcpp::traits::input_parameter< const arma::mat& >::type A_Pseudo(A_PseudoSEXP);
-    Rcpp::traits::input_parameter< double >::type i(iSEXP);
-    Rcpp::traits::input_parameter< double >::type j(jSEXP);
-    Rcpp::traits::input_parameter< const arma::colvec& >::type Sigma_Inv(Sigma_InvSEXP);
-    Rcpp::traits::input_parameter< double >::type N(NSEXP);
-    Rcpp::traits::input_parameter< double >::type p(pSEXP);
-    Rcpp::traits::input_parameter< double >::type gamma(gammaSEXP);
-    Rcpp::traits::input_parameter< double >::type tau(tauSEXP);
-    Rcpp::traits::input_parameter< double >::type nu_1(nu_1SEXP);
-    Rcpp::traits::input_parameter< double >::type prop_var1(prop_var1SEXP);
-    Rcpp::traits::input_parameter< double >::type tA(tASEXP);
-    Rcpp::traits::input_parameter< double >::type Trace3(Trace3SEXP);
-    Rcpp::traits::input_parameter< double >::type Trace4(Trace4SEXP);
-    Rcpp::traits::input_parameter< double >::type Trace5(Trace5SEXP);
-    Rcpp::traits::input_parameter< arma::mat >::type InvMat(InvMatSEXP);
-    Rcpp::traits::input_parameter< double >::type logdet(logdetSEXP);
-    rcpp_result_gen = Rcpp::wrap(Sample_A_Star(S_YY, A, A_Pseudo, i, j, Sigma_Inv, N, p, gamma, tau, nu_1, prop_var1, tA, Trace3, Trace4, Trace5, InvMat, logdet));
-    return rcpp_result_gen;
-END_RCPP
-}
 // LL_Star
 double LL_Star(const arma::mat& A, const arma::mat& S_YY, const arma::colvec& Sigma_Inv, double p, double N);
 RcppExport SEXP _MR_RGM_LL_Star(SEXP ASEXP, SEXP S_YYSEXP, SEXP Sigma_InvSEXP, SEXP pSEXP, SEXP NSEXP) {
@@ -262,20 +62,6 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
-// Sample_tn
-double Sample_tn(double mu, double sigma, double a, double b);
-RcppExport SEXP _MR_RGM_Sample_tn(SEXP muSEXP, SEXP sigmaSEXP, SEXP aSEXP, SEXP bSEXP) {
-BEGIN_RCPP
-    Rcpp::RObject rcpp_result_gen;
-    Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< double >::type mu(muSEXP);
-    Rcpp::traits::input_parameter< double >::type sigma(sigmaSEXP);
-    Rcpp::traits::input_parameter< double >::type a(aSEXP);
-    Rcpp::traits::input_parameter< double >::type b(bSEXP);
-    rcpp_result_gen = Rcpp::wrap(Sample_tn(mu, sigma, a, b));
-    return rcpp_result_gen;
-END_RCPP
-}
 // tn_pdf
 double tn_pdf(double x, double mu, double sigma, double a, double b);
 RcppExport SEXP _MR_RGM_tn_pdf(SEXP xSEXP, SEXP muSEXP, SEXP sigmaSEXP, SEXP aSEXP, SEXP bSEXP) {
@@ -310,8 +96,8 @@ BEGIN_RCPP
 END_RCPP
 }
 // RGM_Threshold2
-Rcpp::List RGM_Threshold2(const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, const arma::mat& D, double n, int nIter, int nBurnin, int Thin, double nu_1, double nu_2, double a_sigma, double b_sigma, double Prop_VarA, double Prop_VarB);
-RcppExport SEXP _MR_RGM_RGM_Threshold2(SEXP S_YYSEXP, SEXP S_YXSEXP, SEXP S_XXSEXP, SEXP DSEXP, SEXP nSEXP, SEXP nIterSEXP, SEXP nBurninSEXP, SEXP ThinSEXP, SEXP nu_1SEXP, SEXP nu_2SEXP, SEXP a_sigmaSEXP, SEXP b_sigmaSEXP, SEXP Prop_VarASEXP, SEXP Prop_VarBSEXP) {
+Rcpp::List RGM_Threshold2(const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, const arma::mat& D, double n, int nIter, int nBurnin, int Thin, double nu_1, double nu_2, double a_sigma, double b_sigma, double Prop_VarA, double Prop_VarB, int nChains, int nRefresh, Rcpp::CharacterVector Store_Pst, bool Pack_Pst, bool Pair_A, bool Adapt_Prop, double Stop_Rhat, double Stop_ESS, int Check_Every, Rcpp::IntegerVector Monitor_A, std::string Checkpoint_File, int Checkpoint_Every, bool Init_MAP, int MAP_Iter, double MAP_Tol, Rcpp::IntegerVector Candidate_A, bool Sparse_A, int Chain_Threads, bool Parallel_B);
+RcppExport SEXP _MR_RGM_RGM_Threshold2(SEXP S_YYSEXP, SEXP S_YXSEXP, SEXP S_XXSEXP, SEXP DSEXP, SEXP nSEXP, SEXP nIterSEXP, SEXP nBurninSEXP, SEXP ThinSEXP, SEXP nu_1SEXP, SEXP nu_2SEXP, SEXP a_sigmaSEXP, SEXP b_sigmaSEXP, SEXP Prop_VarASEXP, SEXP Prop_VarBSEXP, SEXP nChainsSEXP, SEXP nRefreshSEXP, SEXP Store_PstSEXP, SEXP Pack_PstSEXP, SEXP Pair_ASEXP, SEXP Adapt_PropSEXP, SEXP Stop_RhatSEXP, SEXP Stop_ESSSEXP, SEXP Check_EverySEXP, SEXP Monitor_ASEXP, SEXP Checkpoint_FileSEXP, SEXP Checkpoint_EverySEXP, SEXP Init_MAPSEXP, SEXP MAP_IterSEXP, SEXP MAP_TolSEXP, SEXP Candidate_ASEXP, SEXP Sparse_ASEXP, SEXP Chain_ThreadsSEXP, SEXP Parallel_BSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -329,13 +115,32 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< double >::type b_sigma(b_sigmaSEXP);
     Rcpp::traits::input_parameter< double >::type Prop_VarA(Prop_VarASEXP);
     Rcpp::traits::input_parameter< double >::type Prop_VarB(Prop_VarBSEXP);
-    rcpp_result_gen = Rcpp::wrap(RGM_Threshold2(S_YY, S_YX, S_XX, D, n, nIter, nBurnin, Thin, nu_1, nu_2, a_sigma, b_sigma, Prop_VarA, Prop_VarB));
+    Rcpp::traits::input_parameter< int >::type nChains(nChainsSEXP);
+    Rcpp::traits::input_parameter< int >::type nRefresh(nRefreshSEXP);
+    Rcpp::traits::input_parameter< Rcpp::CharacterVector >::type Store_Pst(Store_PstSEXP);
+    Rcpp::traits::input_parameter< bool >::type Pack_Pst(Pack_PstSEXP);
+    Rcpp::traits::input_parameter< bool >::type Pair_A(Pair_ASEXP);
+    Rcpp::traits::input_parameter< bool >::type Adapt_Prop(Adapt_PropSEXP);
+    Rcpp::traits::input_parameter< double >::type Stop_Rhat(Stop_RhatSEXP);
+    Rcpp::traits::input_parameter< double >::type Stop_ESS(Stop_ESSSEXP);
+    Rcpp::traits::input_parameter< int >::type Check_Every(Check_EverySEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type Monitor_A(Monitor_ASEXP);
+    Rcpp::traits::input_parameter< std::string >::type Checkpoint_File(Checkpoint_FileSEXP);
+    Rcpp::traits::input_parameter< int >::type Checkpoint_Every(Checkpoint_EverySEXP);
+    Rcpp::traits::input_parameter< bool >::type Init_MAP(Init_MAPSEXP);
+    Rcpp::traits::input_parameter< int >::type MAP_Iter(MAP_IterSEXP);
+    Rcpp::traits::input_parameter< double >::type MAP_Tol(MAP_TolSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type Candidate_A(Candidate_ASEXP);
+    Rcpp::traits::input_parameter< bool >::type Sparse_A(Sparse_ASEXP);
+    Rcpp::traits::input_parameter< int >::type Chain_Threads(Chain_ThreadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type Parallel_B(Parallel_BSEXP);
+    rcpp_result_gen = Rcpp::wrap(RGM_Threshold2(S_YY, S_YX, S_XX, D, n, nIter, nBurnin, Thin, nu_1, nu_2, a_sigma, b_sigma, Prop_VarA, Prop_VarB, nChains, nRefresh, Store_Pst, Pack_Pst, Pair_A, Adapt_Prop, Stop_Rhat, Stop_ESS, Check_Every, Monitor_A, Checkpoint_File, Checkpoint_Every, Init_MAP, MAP_Iter, MAP_Tol, Candidate_A, Sparse_A, Chain_Threads, Parallel_B));
     return rcpp_result_gen;
 END_RCPP
 }
 // RGM_SpikeSlab2
-Rcpp::List RGM_SpikeSlab2(const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, const arma::mat& D, double n, int nIter, int nBurnin, int Thin, double a_rho, double b_rho, double nu_1, double a_psi, double b_psi, double nu_2, double a_sigma, double b_sigma, double Prop_VarA, double Prop_VarB);
-RcppExport SEXP _MR_RGM_RGM_SpikeSlab2(SEXP S_YYSEXP, SEXP S_YXSEXP, SEXP S_XXSEXP, SEXP DSEXP, SEXP nSEXP, SEXP nIterSEXP, SEXP nBurninSEXP, SEXP ThinSEXP, SEXP a_rhoSEXP, SEXP b_rhoSEXP, SEXP nu_1SEXP, SEXP a_psiSEXP, SEXP b_psiSEXP, SEXP nu_2SEXP, SEXP a_sigmaSEXP, SEXP b_sigmaSEXP, SEXP Prop_VarASEXP, SEXP Prop_VarBSEXP) {
+Rcpp::List RGM_SpikeSlab2(const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, const arma::mat& D, double n, int nIter, int nBurnin, int Thin, double a_rho, double b_rho, double nu_1, double a_psi, double b_psi, double nu_2, double a_sigma, double b_sigma, double Prop_VarA, double Prop_VarB, int nChains, int nRefresh, Rcpp::CharacterVector Store_Pst, bool Pack_Pst, bool Pair_A, bool Adapt_Prop, double Stop_Rhat, double Stop_ESS, int Check_Every, Rcpp::IntegerVector Monitor_A, std::string Checkpoint_File, int Checkpoint_Every, bool Init_MAP, int MAP_Iter, double MAP_Tol, Rcpp::IntegerVector Candidate_A, bool Sparse_A, int Chain_Threads, bool Parallel_B);
+RcppExport SEXP _MR_RGM_RGM_SpikeSlab2(SEXP S_YYSEXP, SEXP S_YXSEXP, SEXP S_XXSEXP, SEXP DSEXP, SEXP nSEXP, SEXP nIterSEXP, SEXP nBurninSEXP, SEXP ThinSEXP, SEXP a_rhoSEXP, SEXP b_rhoSEXP, SEXP nu_1SEXP, SEXP a_psiSEXP, SEXP b_psiSEXP, SEXP nu_2SEXP, SEXP a_sigmaSEXP, SEXP b_sigmaSEXP, SEXP Prop_VarASEXP, SEXP Prop_VarBSEXP, SEXP nChainsSEXP, SEXP nRefreshSEXP, SEXP Store_PstSEXP, SEXP Pack_PstSEXP, SEXP Pair_ASEXP, SEXP Adapt_PropSEXP, SEXP Stop_RhatSEXP, SEXP Stop_ESSSEXP, SEXP Check_EverySEXP, SEXP Monitor_ASEXP, SEXP Checkpoint_FileSEXP, SEXP Checkpoint_EverySEXP, SEXP Init_MAPSEXP, SEXP MAP_IterSEXP, SEXP MAP_TolSEXP, SEXP Candidate_ASEXP, SEXP Sparse_ASEXP, SEXP Chain_ThreadsSEXP, SEXP Parallel_BSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -357,13 +162,32 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< double >::type b_sigma(b_sigmaSEXP);
     Rcpp::traits::input_parameter< double >::type Prop_VarA(Prop_VarASEXP);
     Rcpp::traits::input_parameter< double >::type Prop_VarB(Prop_VarBSEXP);
-    rcpp_result_gen = Rcpp::wrap(RGM_SpikeSlab2(S_YY, S_YX, S_XX, D, n, nIter, nBurnin, Thin, a_rho, b_rho, nu_1, a_psi, b_psi, nu_2, a_sigma, b_sigma, Prop_VarA, Prop_VarB));
+    Rcpp::traits::input_parameter< int >::type nChains(nChainsSEXP);
+    Rcpp::traits::input_parameter< int >::type nRefresh(nRefreshSEXP);
+    Rcpp::traits::input_parameter< Rcpp::CharacterVector >::type Store_Pst(Store_PstSEXP);
+    Rcpp::traits::input_parameter< bool >::type Pack_Pst(Pack_PstSEXP);
+    Rcpp::traits::input_parameter< bool >::type Pair_A(Pair_ASEXP);
+    Rcpp::traits::input_parameter< bool >::type Adapt_Prop(Adapt_PropSEXP);
+    Rcpp::traits::input_parameter< double >::type Stop_Rhat(Stop_RhatSEXP);
+    Rcpp::traits::input_parameter< double >::type Stop_ESS(Stop_ESSSEXP);
+    Rcpp::traits::input_parameter< int >::type Check_Every(Check_EverySEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type Monitor_A(Monitor_ASEXP);
+    Rcpp::traits::input_parameter< std::string >::type Checkpoint_File(Checkpoint_FileSEXP);
+    Rcpp::traits::input_parameter< int >::type Checkpoint_Every(Checkpoint_EverySEXP);
+    Rcpp::traits::input_parameter< bool >::type Init_MAP(Init_MAPSEXP);
+    Rcpp::traits::input_parameter< int >::type MAP_Iter(MAP_IterSEXP);
+    Rcpp::traits::input_parameter< double >::type MAP_Tol(MAP_TolSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type Candidate_A(Candidate_ASEXP);
+    Rcpp::traits::input_parameter< bool >::type Sparse_A(Sparse_ASEXP);
+    Rcpp::traits::input_parameter< int >::type Chain_Threads(Chain_ThreadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type Parallel_B(Parallel_BSEXP);
+    rcpp_result_gen = Rcpp::wrap(RGM_SpikeSlab2(S_YY, S_YX, S_XX, D, n, nIter, nBurnin, Thin, a_rho, b_rho, nu_1, a_psi, b_psi, nu_2, a_sigma, b_sigma, Prop_VarA, Prop_VarB, nChains, nRefresh, Store_Pst, Pack_Pst, Pair_A, Adapt_Prop, Stop_Rhat, Stop_ESS, Check_Every, Monitor_A, Checkpoint_File, Checkpoint_Every, Init_MAP, MAP_Iter, MAP_Tol, Candidate_A, Sparse_A, Chain_Threads, Parallel_B));
     return rcpp_result_gen;
 END_RCPP
 }
 // RGM_Threshold1
-Rcpp::List RGM_Threshold1(const arma::mat& S_YY, double n, int nIter, int nBurnin, int Thin, double nu_1, double a_sigma, double b_sigma, double Prop_VarA);
-RcppExport SEXP _MR_RGM_RGM_Threshold1(SEXP S_YYSEXP, SEXP nSEXP, SEXP nIterSEXP, SEXP nBurninSEXP, SEXP ThinSEXP, SEXP nu_1SEXP, SEXP a_sigmaSEXP, SEXP b_sigmaSEXP, SEXP Prop_VarASEXP) {
+Rcpp::List RGM_Threshold1(const arma::mat& S_YY, double n, int nIter, int nBurnin, int Thin, double nu_1, double a_sigma, double b_sigma, double Prop_VarA, int nChains, int nRefresh, Rcpp::CharacterVector Store_Pst, bool Pack_Pst, bool Pair_A, bool Adapt_Prop, double Stop_Rhat, double Stop_ESS, int Check_Every, Rcpp::IntegerVector Monitor_A, std::string Checkpoint_File, int Checkpoint_Every, bool Init_MAP, int MAP_Iter, double MAP_Tol, Rcpp::IntegerVector Candidate_A, bool Sparse_A, int Chain_Threads);
+RcppExport SEXP _MR_RGM_RGM_Threshold1(SEXP S_YYSEXP, SEXP nSEXP, SEXP nIterSEXP, SEXP nBurninSEXP, SEXP ThinSEXP, SEXP nu_1SEXP, SEXP a_sigmaSEXP, SEXP b_sigmaSEXP, SEXP Prop_VarASEXP, SEXP nChainsSEXP, SEXP nRefreshSEXP, SEXP Store_PstSEXP, SEXP Pack_PstSEXP, SEXP Pair_ASEXP, SEXP Adapt_PropSEXP, SEXP Stop_RhatSEXP, SEXP Stop_ESSSEXP, SEXP Check_EverySEXP, SEXP Monitor_ASEXP, SEXP Checkpoint_FileSEXP, SEXP Checkpoint_EverySEXP, SEXP Init_MAPSEXP, SEXP MAP_IterSEXP, SEXP MAP_TolSEXP, SEXP Candidate_ASEXP, SEXP Sparse_ASEXP, SEXP Chain_ThreadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -376,13 +200,31 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< double >::type a_sigma(a_sigmaSEXP);
     Rcpp::traits::input_parameter< double >::type b_sigma(b_sigmaSEXP);
     Rcpp::traits::input_parameter< double >::type Prop_VarA(Prop_VarASEXP);
-    rcpp_result_gen = Rcpp::wrap(RGM_Threshold1(S_YY, n, nIter, nBurnin, Thin, nu_1, a_sigma, b_sigma, Prop_VarA));
+    Rcpp::traits::input_parameter< int >::type nChains(nChainsSEXP);
+    Rcpp::traits::input_parameter< int >::type nRefresh(nRefreshSEXP);
+    Rcpp::traits::input_parameter< Rcpp::CharacterVector >::type Store_Pst(Store_PstSEXP);
+    Rcpp::traits::input_parameter< bool >::type Pack_Pst(Pack_PstSEXP);
+    Rcpp::traits::input_parameter< bool >::type Pair_A(Pair_ASEXP);
+    Rcpp::traits::input_parameter< bool >::type Adapt_Prop(Adapt_PropSEXP);
+    Rcpp::traits::input_parameter< double >::type Stop_Rhat(Stop_RhatSEXP);
+    Rcpp::traits::input_parameter< double >::type Stop_ESS(Stop_ESSSEXP);
+    Rcpp::traits::input_parameter< int >::type Check_Every(Check_EverySEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type Monitor_A(Monitor_ASEXP);
+    Rcpp::traits::input_parameter< std::string >::type Checkpoint_File(Checkpoint_FileSEXP);
+    Rcpp::traits::input_parameter< int >::type Checkpoint_Every(Checkpoint_EverySEXP);
+    Rcpp::traits::input_parameter< bool >::type Init_MAP(Init_MAPSEXP);
+    Rcpp::traits::input_parameter< int >::type MAP_Iter(MAP_IterSEXP);
+    Rcpp::traits::input_parameter< double >::type MAP_Tol(MAP_TolSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type Candidate_A(Candidate_ASEXP);
+    Rcpp::traits::input_parameter< bool >::type Sparse_A(Sparse_ASEXP);
+    Rcpp::traits::input_parameter< int >::type Chain_Threads(Chain_ThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(RGM_Threshold1(S_YY, n, nIter, nBurnin, Thin, nu_1, a_sigma, b_sigma, Prop_VarA, nChains, nRefresh, Store_Pst, Pack_Pst, Pair_A, Adapt_Prop, Stop_Rhat, Stop_ESS, Check_Every, Monitor_A, Checkpoint_File, Checkpoint_Every, Init_MAP, MAP_Iter, MAP_Tol, Candidate_A, Sparse_A, Chain_Threads));
     return rcpp_result_gen;
 END_RCPP
 }
 // RGM_SpikeSlab1
-Rcpp::List RGM_SpikeSlab1(const arma::mat& S_YY, double n, int nIter, int nBurnin, int Thin, double a_rho, double b_rho, double nu_1, double a_sigma, double b_sigma, double Prop_VarA);
-RcppExport SEXP _MR_RGM_RGM_SpikeSlab1(SEXP S_YYSEXP, SEXP nSEXP, SEXP nIterSEXP, SEXP nBurninSEXP, SEXP ThinSEXP, SEXP a_rhoSEXP, SEXP b_rhoSEXP, SEXP nu_1SEXP, SEXP a_sigmaSEXP, SEXP b_sigmaSEXP, SEXP Prop_VarASEXP) {
+Rcpp::List RGM_SpikeSlab1(const arma::mat& S_YY, double n, int nIter, int nBurnin, int Thin, double a_rho, double b_rho, double nu_1, double a_sigma, double b_sigma, double Prop_VarA, int nChains, int nRefresh, Rcpp::CharacterVector Store_Pst, bool Pack_Pst, bool Pair_A, bool Adapt_Prop, double Stop_Rhat, double Stop_ESS, int Check_Every, Rcpp::IntegerVector Monitor_A, std::string Checkpoint_File, int Checkpoint_Every, bool Init_MAP, int MAP_Iter, double MAP_Tol, Rcpp::IntegerVector Candidate_A, bool Sparse_A, int Chain_Threads);
+RcppExport SEXP _MR_RGM_RGM_SpikeSlab1(SEXP S_YYSEXP, SEXP nSEXP, SEXP nIterSEXP, SEXP nBurninSEXP, SEXP ThinSEXP, SEXP a_rhoSEXP, SEXP b_rhoSEXP, SEXP nu_1SEXP, SEXP a_sigmaSEXP, SEXP b_sigmaSEXP, SEXP Prop_VarASEXP, SEXP nChainsSEXP, SEXP nRefreshSEXP, SEXP Store_PstSEXP, SEXP Pack_PstSEXP, SEXP Pair_ASEXP, SEXP Adapt_PropSEXP, SEXP Stop_RhatSEXP, SEXP Stop_ESSSEXP, SEXP Check_EverySEXP, SEXP Monitor_ASEXP, SEXP Checkpoint_FileSEXP, SEXP Checkpoint_EverySEXP, SEXP Init_MAPSEXP, SEXP MAP_IterSEXP, SEXP MAP_TolSEXP, SEXP Candidate_ASEXP, SEXP Sparse_ASEXP, SEXP Chain_ThreadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -397,46 +239,277 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< double >::type a_sigma(a_sigmaSEXP);
     Rcpp::traits::input_parameter< double >::type b_sigma(b_sigmaSEXP);
     Rcpp::traits::input_parameter< double >::type Prop_VarA(Prop_VarASEXP);
-    rcpp_result_gen = Rcpp::wrap(RGM_SpikeSlab1(S_YY, n, nIter, nBurnin, Thin, a_rho, b_rho, nu_1, a_sigma, b_sigma, Prop_VarA));
+    Rcpp::traits::input_parameter< int >::type nChains(nChainsSEXP);
+    Rcpp::traits::input_parameter< int >::type nRefresh(nRefreshSEXP);
+    Rcpp::traits::input_parameter< Rcpp::CharacterVector >::type Store_Pst(Store_PstSEXP);
+    Rcpp::traits::input_parameter< bool >::type Pack_Pst(Pack_PstSEXP);
+    Rcpp::traits::input_parameter< bool >::type Pair_A(Pair_ASEXP);
+    Rcpp::traits::input_parameter< bool >::type Adapt_Prop(Adapt_PropSEXP);
+    Rcpp::traits::input_parameter< double >::type Stop_Rhat(Stop_RhatSEXP);
+    Rcpp::traits::input_parameter< double >::type Stop_ESS(Stop_ESSSEXP);
+    Rcpp::traits::input_parameter< int >::type Check_Every(Check_EverySEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type Monitor_A(Monitor_ASEXP);
+    Rcpp::traits::input_parameter< std::string >::type Checkpoint_File(Checkpoint_FileSEXP);
+    Rcpp::traits::input_parameter< int >::type Checkpoint_Every(Checkpoint_EverySEXP);
+    Rcpp::traits::input_parameter< bool >::type Init_MAP(Init_MAPSEXP);
+    Rcpp::traits::input_parameter< int >::type MAP_Iter(MAP_IterSEXP);
+    Rcpp::traits::input_parameter< double >::type MAP_Tol(MAP_TolSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type Candidate_A(Candidate_ASEXP);
+    Rcpp::traits::input_parameter< bool >::type Sparse_A(Sparse_ASEXP);
+    Rcpp::traits::input_parameter< int >::type Chain_Threads(Chain_ThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(RGM_SpikeSlab1(S_YY, n, nIter, nBurnin, Thin, a_rho, b_rho, nu_1, a_sigma, b_sigma, Prop_VarA, nChains, nRefresh, Store_Pst, Pack_Pst, Pair_A, Adapt_Prop, Stop_Rhat, Stop_ESS, Check_Every, Monitor_A, Checkpoint_File, Checkpoint_Every, Init_MAP, MAP_Iter, MAP_Tol, Candidate_A, Sparse_A, Chain_Threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// RGM_MAP
+Rcpp::List RGM_MAP(const arma::mat& S_YY, const arma::mat& S_YX, const arma::mat& S_XX, const arma::mat& D, double n, bool Thresholded, double a_rho, double b_rho, double nu_1, double a_psi, double b_psi, double nu_2, double a_sigma, double b_sigma, int MAP_Iter, double MAP_Tol, Rcpp::IntegerVector Candidate_A, bool Sparse_A);
+RcppExport SEXP _MR_RGM_RGM_MAP(SEXP S_YYSEXP, SEXP S_YXSEXP, SEXP S_XXSEXP, SEXP DSEXP, SEXP nSEXP, SEXP ThresholdedSEXP, SEXP a_rhoSEXP, SEXP b_rhoSEXP, SEXP nu_1SEXP, SEXP a_psiSEXP, SEXP b_psiSEXP, SEXP nu_2SEXP, SEXP a_sigmaSEXP, SEXP b_sigmaSEXP, SEXP MAP_IterSEXP, SEXP MAP_TolSEXP, SEXP Candidate_ASEXP, SEXP Sparse_ASEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const arma::mat& >::type S_YY(S_YYSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type S_YX(S_YXSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type S_XX(S_XXSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type D(DSEXP);
+    Rcpp::traits::input_parameter< double >::type n(nSEXP);
+    Rcpp::traits::input_parameter< bool >::type Thresholded(ThresholdedSEXP);
+    Rcpp::traits::input_parameter< double >::type a_rho(a_rhoSEXP);
+    Rcpp::traits::input_parameter< double >::type b_rho(b_rhoSEXP);
+    Rcpp::traits::input_parameter< double >::type nu_1(nu_1SEXP);
+    Rcpp::traits::input_parameter< double >::type a_psi(a_psiSEXP);
+    Rcpp::traits::input_parameter< double >::type b_psi(b_psiSEXP);
+    Rcpp::traits::input_parameter< double >::type nu_2(nu_2SEXP);
+    Rcpp::traits::input_parameter< double >::type a_sigma(a_sigmaSEXP);
+    Rcpp::traits::input_parameter< double >::type b_sigma(b_sigmaSEXP);
+    Rcpp::traits::input_parameter< int >::type MAP_Iter(MAP_IterSEXP);
+    Rcpp::traits::input_parameter< double >::type MAP_Tol(MAP_TolSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type Candidate_A(Candidate_ASEXP);
+    Rcpp::traits::input_parameter< bool >::type Sparse_A(Sparse_ASEXP);
+    rcpp_result_gen = Rcpp::wrap(RGM_MAP(S_YY, S_YX, S_XX, D, n, Thresholded, a_rho, b_rho, nu_1, a_psi, b_psi, nu_2, a_sigma, b_sigma, MAP_Iter, MAP_Tol, Candidate_A, Sparse_A));
+    return rcpp_result_gen;
+END_RCPP
+}
+// RGM_Resume_cpp
+Rcpp::List RGM_Resume_cpp(std::string Checkpoint_File, int nIter);
+RcppExport SEXP _MR_RGM_RGM_Resume_cpp(SEXP Checkpoint_FileSEXP, SEXP nIterSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type Checkpoint_File(Checkpoint_FileSEXP);
+    Rcpp::traits::input_parameter< int >::type nIter(nIterSEXP);
+    rcpp_result_gen = Rcpp::wrap(RGM_Resume_cpp(Checkpoint_File, nIter));
     return rcpp_result_gen;
 END_RCPP
 }
 // NetworkMotif_cpp
-double NetworkMotif_cpp(const arma::mat& Gamma, const arma::cube& Gamma_Pst);
-RcppExport SEXP _MR_RGM_NetworkMotif_cpp(SEXP GammaSEXP, SEXP Gamma_PstSEXP) {
+double NetworkMotif_cpp(const arma::mat& Gamma, const arma::cube& Gamma_Pst, int nThreads);
+RcppExport SEXP _MR_RGM_NetworkMotif_cpp(SEXP GammaSEXP, SEXP Gamma_PstSEXP, SEXP nThreadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< const arma::mat& >::type Gamma(GammaSEXP);
     Rcpp::traits::input_parameter< const arma::cube& >::type Gamma_Pst(Gamma_PstSEXP);
-    rcpp_result_gen = Rcpp::wrap(NetworkMotif_cpp(Gamma, Gamma_Pst));
+    Rcpp::traits::input_parameter< int >::type nThreads(nThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(NetworkMotif_cpp(Gamma, Gamma_Pst, nThreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// NetworkMotif_Packed_cpp
+double NetworkMotif_Packed_cpp(const arma::mat& Gamma, const Rcpp::RawVector& Gamma_Pst, int nThreads);
+RcppExport SEXP _MR_RGM_NetworkMotif_Packed_cpp(SEXP GammaSEXP, SEXP Gamma_PstSEXP, SEXP nThreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const arma::mat& >::type Gamma(GammaSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::RawVector& >::type Gamma_Pst(Gamma_PstSEXP);
+    Rcpp::traits::input_parameter< int >::type nThreads(nThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(NetworkMotif_Packed_cpp(Gamma, Gamma_Pst, nThreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// NetworkMotif_Batch_cpp
+arma::colvec NetworkMotif_Batch_cpp(const arma::cube& Gammas, const arma::cube& Gamma_Pst, int nThreads);
+RcppExport SEXP _MR_RGM_NetworkMotif_Batch_cpp(SEXP GammasSEXP, SEXP Gamma_PstSEXP, SEXP nThreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const arma::cube& >::type Gammas(GammasSEXP);
+    Rcpp::traits::input_parameter< const arma::cube& >::type Gamma_Pst(Gamma_PstSEXP);
+    Rcpp::traits::input_parameter< int >::type nThreads(nThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(NetworkMotif_Batch_cpp(Gammas, Gamma_Pst, nThreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// NetworkMotif_Batch_Packed_cpp
+arma::colvec NetworkMotif_Batch_Packed_cpp(const arma::cube& Gammas, const Rcpp::RawVector& Gamma_Pst, int nThreads);
+RcppExport SEXP _MR_RGM_NetworkMotif_Batch_Packed_cpp(SEXP GammasSEXP, SEXP Gamma_PstSEXP, SEXP nThreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const arma::cube& >::type Gammas(GammasSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::RawVector& >::type Gamma_Pst(Gamma_PstSEXP);
+    Rcpp::traits::input_parameter< int >::type nThreads(nThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(NetworkMotif_Batch_Packed_cpp(Gammas, Gamma_Pst, nThreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// NetworkMotif_Edges_cpp
+arma::colvec NetworkMotif_Edges_cpp(const Rcpp::IntegerVector& Motif, const Rcpp::IntegerVector& Row, const Rcpp::IntegerVector& Col, int nMotif, const arma::cube& Gamma_Pst, int nThreads);
+RcppExport SEXP _MR_RGM_NetworkMotif_Edges_cpp(SEXP MotifSEXP, SEXP RowSEXP, SEXP ColSEXP, SEXP nMotifSEXP, SEXP Gamma_PstSEXP, SEXP nThreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Rcpp::IntegerVector& >::type Motif(MotifSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerVector& >::type Row(RowSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerVector& >::type Col(ColSEXP);
+    Rcpp::traits::input_parameter< int >::type nMotif(nMotifSEXP);
+    Rcpp::traits::input_parameter< const arma::cube& >::type Gamma_Pst(Gamma_PstSEXP);
+    Rcpp::traits::input_parameter< int >::type nThreads(nThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(NetworkMotif_Edges_cpp(Motif, Row, Col, nMotif, Gamma_Pst, nThreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// NetworkMotif_Edges_Packed_cpp
+arma::colvec NetworkMotif_Edges_Packed_cpp(const Rcpp::IntegerVector& Motif, const Rcpp::IntegerVector& Row, const Rcpp::IntegerVector& Col, int nMotif, const Rcpp::RawVector& Gamma_Pst, int nThreads);
+RcppExport SEXP _MR_RGM_NetworkMotif_Edges_Packed_cpp(SEXP MotifSEXP, SEXP RowSEXP, SEXP ColSEXP, SEXP nMotifSEXP, SEXP Gamma_PstSEXP, SEXP nThreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Rcpp::IntegerVector& >::type Motif(MotifSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerVector& >::type Row(RowSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerVector& >::type Col(ColSEXP);
+    Rcpp::traits::input_parameter< int >::type nMotif(nMotifSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::RawVector& >::type Gamma_Pst(Gamma_PstSEXP);
+    Rcpp::traits::input_parameter< int >::type nThreads(nThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(NetworkMotif_Edges_Packed_cpp(Motif, Row, Col, nMotif, Gamma_Pst, nThreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Unpack_Pst_cpp
+arma::cube Unpack_Pst_cpp(const Rcpp::RawVector& Pst, const Rcpp::IntegerVector& Slices);
+RcppExport SEXP _MR_RGM_Unpack_Pst_cpp(SEXP PstSEXP, SEXP SlicesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Rcpp::RawVector& >::type Pst(PstSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerVector& >::type Slices(SlicesSEXP);
+    rcpp_result_gen = Rcpp::wrap(Unpack_Pst_cpp(Pst, Slices));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Edge_Pst_cpp
+arma::colvec Edge_Pst_cpp(const Rcpp::RawVector& Pst, int Row, int Col);
+RcppExport SEXP _MR_RGM_Edge_Pst_cpp(SEXP PstSEXP, SEXP RowSEXP, SEXP ColSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Rcpp::RawVector& >::type Pst(PstSEXP);
+    Rcpp::traits::input_parameter< int >::type Row(RowSEXP);
+    Rcpp::traits::input_parameter< int >::type Col(ColSEXP);
+    rcpp_result_gen = Rcpp::wrap(Edge_Pst_cpp(Pst, Row, Col));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Gram_Create_cpp
+SEXP Gram_Create_cpp(int p, int k);
+RcppExport SEXP _MR_RGM_Gram_Create_cpp(SEXP pSEXP, SEXP kSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type p(pSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    rcpp_result_gen = Rcpp::wrap(Gram_Create_cpp(p, k));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Gram_Update_cpp
+void Gram_Update_cpp(SEXP Builder, const arma::mat& Y, const arma::mat& X);
+RcppExport SEXP _MR_RGM_Gram_Update_cpp(SEXP BuilderSEXP, SEXP YSEXP, SEXP XSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type Builder(BuilderSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type Y(YSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type X(XSEXP);
+    Gram_Update_cpp(Builder, Y, X);
+    return R_NilValue;
+END_RCPP
+}
+// Gram_Result_cpp
+Rcpp::List Gram_Result_cpp(SEXP Builder);
+RcppExport SEXP _MR_RGM_Gram_Result_cpp(SEXP BuilderSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type Builder(BuilderSEXP);
+    rcpp_result_gen = Rcpp::wrap(Gram_Result_cpp(Builder));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Binary_Stats_cpp
+Rcpp::List Binary_Stats_cpp(std::string File, int Chunk_Rows);
+RcppExport SEXP _MR_RGM_Binary_Stats_cpp(SEXP FileSEXP, SEXP Chunk_RowsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type File(FileSEXP);
+    Rcpp::traits::input_parameter< int >::type Chunk_Rows(Chunk_RowsSEXP);
+    rcpp_result_gen = Rcpp::wrap(Binary_Stats_cpp(File, Chunk_Rows));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Binary_Hash_cpp
+std::string Binary_Hash_cpp(std::string File);
+RcppExport SEXP _MR_RGM_Binary_Hash_cpp(SEXP FileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type File(FileSEXP);
+    rcpp_result_gen = Rcpp::wrap(Binary_Hash_cpp(File));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Beta_S_YY_cpp
+arma::mat Beta_S_YY_cpp(const arma::mat& Beta, const arma::mat& Sigma_Hat, const arma::mat& S_XX, const arma::mat& S_YX, const arma::colvec& d);
+RcppExport SEXP _MR_RGM_Beta_S_YY_cpp(SEXP BetaSEXP, SEXP Sigma_HatSEXP, SEXP S_XXSEXP, SEXP S_YXSEXP, SEXP dSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const arma::mat& >::type Beta(BetaSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type Sigma_Hat(Sigma_HatSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type S_XX(S_XXSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type S_YX(S_YXSEXP);
+    Rcpp::traits::input_parameter< const arma::colvec& >::type d(dSEXP);
+    rcpp_result_gen = Rcpp::wrap(Beta_S_YY_cpp(Beta, Sigma_Hat, S_XX, S_YX, d));
     return rcpp_result_gen;
 END_RCPP
 }
 
 static const R_CallMethodDef CallEntries[] = {
-    {"_MR_RGM_Sample_Rho", (DL_FUNC) &_MR_RGM_Sample_Rho, 3},
-    {"_MR_RGM_Sample_Psi", (DL_FUNC) &_MR_RGM_Sample_Psi, 3},
-    {"_MR_RGM_Sample_Tau", (DL_FUNC) &_MR_RGM_Sample_Tau, 4},
-    {"_MR_RGM_Sample_Eta", (DL_FUNC) &_MR_RGM_Sample_Eta, 4},
-    {"_MR_RGM_Sample_Gamma", (DL_FUNC) &_MR_RGM_Sample_Gamma, 4},
-    {"_MR_RGM_Sample_Phi", (DL_FUNC) &_MR_RGM_Sample_Phi, 4},
-    {"_MR_RGM_Sample_Sigma", (DL_FUNC) &_MR_RGM_Sample_Sigma, 4},
     {"_MR_RGM_Target_A", (DL_FUNC) &_MR_RGM_Target_A, 10},
-    {"_MR_RGM_Sample_A", (DL_FUNC) &_MR_RGM_Sample_A, 21},
     {"_MR_RGM_Target_B", (DL_FUNC) &_MR_RGM_Target_B, 6},
-    {"_MR_RGM_Sample_B", (DL_FUNC) &_MR_RGM_Sample_B, 16},
-    {"_MR_RGM_Target_A_Star", (DL_FUNC) &_MR_RGM_Target_A_Star, 9},
-    {"_MR_RGM_Sample_A_Star", (DL_FUNC) &_MR_RGM_Sample_A_Star, 18},
     {"_MR_RGM_LL_Star", (DL_FUNC) &_MR_RGM_LL_Star, 5},
-    {"_MR_RGM_Sample_tn", (DL_FUNC) &_MR_RGM_Sample_tn, 4},
     {"_MR_RGM_tn_pdf", (DL_FUNC) &_MR_RGM_tn_pdf, 5},
     {"_MR_RGM_LL", (DL_FUNC) &_MR_RGM_LL, 8},
-    {"_MR_RGM_RGM_Threshold2", (DL_FUNC) &_MR_RGM_RGM_Threshold2, 14},
-    {"_MR_RGM_RGM_SpikeSlab2", (DL_FUNC) &_MR_RGM_RGM_SpikeSlab2, 18},
-    {"_MR_RGM_RGM_Threshold1", (DL_FUNC) &_MR_RGM_RGM_Threshold1, 9},
-    {"_MR_RGM_RGM_SpikeSlab1", (DL_FUNC) &_MR_RGM_RGM_SpikeSlab1, 11},
-    {"_MR_RGM_NetworkMotif_cpp", (DL_FUNC) &_MR_RGM_NetworkMotif_cpp, 2},
+    {"_MR_RGM_RGM_Threshold2", (DL_FUNC) &_MR_RGM_RGM_Threshold2, 33},
+    {"_MR_RGM_RGM_SpikeSlab2", (DL_FUNC) &_MR_RGM_RGM_SpikeSlab2, 37},
+    {"_MR_RGM_RGM_Threshold1", (DL_FUNC) &_MR_RGM_RGM_Threshold1, 27},
+    {"_MR_RGM_RGM_SpikeSlab1", (DL_FUNC) &_MR_RGM_RGM_SpikeSlab1, 29},
+    {"_MR_RGM_RGM_MAP", (DL_FUNC) &_MR_RGM_RGM_MAP, 18},
+    {"_MR_RGM_RGM_Resume_cpp", (DL_FUNC) &_MR_RGM_RGM_Resume_cpp, 2},
+    {"_MR_RGM_NetworkMotif_cpp", (DL_FUNC) &_MR_RGM_NetworkMotif_cpp, 3},
+    {"_MR_RGM_NetworkMotif_Packed_cpp", (DL_FUNC) &_MR_RGM_NetworkMotif_Packed_cpp, 3},
+    {"_MR_RGM_NetworkMotif_Batch_cpp", (DL_FUNC) &_MR_RGM_NetworkMotif_Batch_cpp, 3},
+    {"_MR_RGM_NetworkMotif_Batch_Packed_cpp", (DL_FUNC) &_MR_RGM_NetworkMotif_Batch_Packed_cpp, 3},
+    {"_MR_RGM_NetworkMotif_Edges_cpp", (DL_FUNC) &_MR_RGM_NetworkMotif_Edges_cpp, 6},
+    {"_MR_RGM_NetworkMotif_Edges_Packed_cpp", (DL_FUNC) &_MR_RGM_NetworkMotif_Edges_Packed_cpp, 6},
+    {"_MR_RGM_Unpack_Pst_cpp", (DL_FUNC) &_MR_RGM_Unpack_Pst_cpp, 2},
+    {"_MR_RGM_Edge_Pst_cpp", (DL_FUNC) &_MR_RGM_Edge_Pst_cpp, 3},
+    {"_MR_RGM_Gram_Create_cpp", (DL_FUNC) &_MR_RGM_Gram_Create_cpp, 2},
+    {"_MR_RGM_Gram_Update_cpp", (DL_FUNC) &_MR_RGM_Gram_Update_cpp, 3},
+    {"_MR_RGM_Gram_Result_cpp", (DL_FUNC) &_MR_RGM_Gram_Result_cpp, 1},
+    {"_MR_RGM_Binary_Stats_cpp", (DL_FUNC) &_MR_RGM_Binary_Stats_cpp, 2},
+    {"_MR_RGM_Binary_Hash_cpp", (DL_FUNC) &_MR_RGM_Binary_Hash_cpp, 1},
+    {"_MR_RGM_Beta_S_YY_cpp", (DL_FUNC) &_MR_RGM_Beta_S_YY_cpp, 5},
     {NULL, NULL, 0}
 };
 
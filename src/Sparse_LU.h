@@ -0,0 +1,662 @@
+#ifndef RGM_SPARSE_LU_H
+#define RGM_SPARSE_LU_H
+
+#include <RcppArmadillo.h>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+
+// Sparse LU factorization of I - A with low rank updates
+// I - A is ordered by the strongly connected components of the graph of A in topological order, which makes it
+// block upper triangular, so a graph without cycles has no fill at all and the fill of a reciprocal graph stays
+// within its cycles. The ordered matrix is factorized column by column with the left-looking algorithm of Gilbert
+// and Peierls and threshold partial pivoting that prefers the diagonal. A change x of entry (i, j) of A is not
+// refactorized but kept as a rank 1 update, so with the changes U V' since the factorization of M0,
+// (I - A)^(-1) = M0^(-1) + W K^(-1) V' M0^(-1) with W = M0^(-1) U and K = I - V' W by the Woodbury identity.
+// After Max_Rank changes the factorization is recalculated from A. Columns of (I - A)^(-1) are solved on demand
+// and the last one is kept, as the proposals of a row of A all read the same column
+class Sparse_LU {
+
+public:
+
+  // Dimension and maximum number of rank 1 updates before refactorization
+  int p, Max_Rank;
+
+  // Initialize an empty factorization
+  explicit Sparse_LU(int Max_Rank = 32) : p(0), Max_Rank(Max_Rank), Log_Det0(0), Cached_Index(-1) {}
+
+  // Factorize I - A and drop the updates
+  void Factorize(const arma::mat& A) {
+
+    Factorize(A.n_rows, A.memptr());
+
+  }
+
+  // Factorize I - A for the column major p x p matrix A and drop the updates
+  void Factorize(int n, const double* A) {
+
+    p = n;
+
+    Order(A);
+    Decompose(A);
+
+    Upd_Row.clear();
+    Upd_Col.clear();
+    W.clear();
+    K_Inv.clear();
+    Cached_Index = -1;
+
+  }
+
+  // Return log(|det(I - A)|) of the factorized matrix without the updates
+  double Log_Det() const {
+
+    return Log_Det0;
+
+  }
+
+  // Return column i of (I - A)^(-1) with the updates
+  const std::vector<double>& Column(int i) {
+
+    if (Cached_Index != i) {
+
+      // Solve with the factorization
+      Solve(i, Cached);
+
+      // Add W K^(-1) V' M0^(-1) e_i
+      int r = Upd_Row.size();
+
+      if (r > 0) {
+
+        std::vector<double> t(r), s(r, 0);
+
+        for (int a = 0; a < r; a++) {
+
+          t[a] = Cached[Upd_Col[a]];
+
+        }
+
+        for (int b = 0; b < r; b++) {
+
+          for (int a = 0; a < r; a++) {
+
+            s[a] += K_Inv[a + b * r] * t[b];
+
+          }
+
+        }
+
+        for (int a = 0; a < r; a++) {
+
+          const double* W_a = &W[(size_t) a * p];
+
+          for (int l = 0; l < p; l++) {
+
+            Cached[l] += W_a[l] * s[a];
+
+          }
+
+        }
+
+      }
+
+      Cached_Index = i;
+
+    }
+
+    return Cached;
+
+  }
+
+  // Return entry (j, i) of (I - A)^(-1) with the updates
+  double Entry(int j, int i) {
+
+    return Column(i)[j];
+
+  }
+
+  // Add the change x of entry (i, j) of A, where A already holds the changed entry
+  void Update(int i, int j, double x, const arma::mat& A) {
+
+    int r = Upd_Row.size();
+
+    // Refactorize when the updates are used up
+    if (r == Max_Rank) {
+
+      Factorize(A);
+      return;
+
+    }
+
+    // Calculate w = M0^(-1) e_i x, the new column of W
+    std::vector<double> w;
+    Solve(i, w);
+
+    for (int l = 0; l < p; l++) {
+
+      w[l] *= x;
+
+    }
+
+    // Border K with b = - V' w, c = - W' e_j and d = 1 - w_j, and its inverse with the Schur complement
+    // s = d - c' K^(-1) b
+    std::vector<double> Kb(r, 0), cK(r, 0);
+
+    for (int b = 0; b < r; b++) {
+
+      double b_b = - w[Upd_Col[b]];
+      double c_b = - W[(size_t) b * p + j];
+
+      for (int a = 0; a < r; a++) {
+
+        Kb[a] += K_Inv[a + b * r] * b_b;
+        cK[a] += c_b * K_Inv[b + a * r];
+
+      }
+
+    }
+
+    double s = 1 - w[j];
+
+    for (int a = 0; a < r; a++) {
+
+      s -= - W[(size_t) a * p + j] * Kb[a];
+
+    }
+
+    // Refactorize if the update is close to singular
+    if (std::abs(s) < 1e-8) {
+
+      Factorize(A);
+      return;
+
+    }
+
+    // Update the column of the changed row before the inverse changes, (I - A_new)^(-1) e_i = c / (1 - x c_j)
+    if (Cached_Index == i) {
+
+      double Scale = 1 / (1 - x * Cached[j]);
+
+      for (int l = 0; l < p; l++) {
+
+        Cached[l] *= Scale;
+
+      }
+
+    } else {
+
+      Cached_Index = -1;
+
+    }
+
+    // Form the bordered inverse
+    std::vector<double> K_New((size_t) (r + 1) * (r + 1));
+
+    for (int b = 0; b < r; b++) {
+
+      for (int a = 0; a < r; a++) {
+
+        K_New[a + b * (r + 1)] = K_Inv[a + b * r] + Kb[a] * cK[b] / s;
+
+      }
+
+      K_New[r + b * (r + 1)] = - cK[b] / s;
+      K_New[b + r * (r + 1)] = - Kb[b] / s;
+
+    }
+
+    K_New[r + r * (r + 1)] = 1 / s;
+
+    K_Inv.swap(K_New);
+    W.insert(W.end(), w.begin(), w.end());
+    Upd_Row.push_back(i);
+    Upd_Col.push_back(j);
+
+  }
+
+  // Save or restore the factorization, its updates and the kept column
+  template <typename Archive>
+  void Serialize(Archive& Ar) {
+
+    Ar.Value(p);
+    Ar.Value(Max_Rank);
+    Ar.Value(Log_Det0);
+    Ar.Vector(Q);
+    Ar.Vector(Q_Inv);
+    Ar.Vector(P_Inv);
+    Ar.Vector(Lp);
+    Ar.Vector(Li);
+    Ar.Vector(Lx);
+    Ar.Vector(Up);
+    Ar.Vector(Ui);
+    Ar.Vector(Ux);
+    Ar.Vector(Upd_Row);
+    Ar.Vector(Upd_Col);
+    Ar.Vector(W);
+    Ar.Vector(K_Inv);
+    Ar.Value(Cached_Index);
+    Ar.Vector(Cached);
+
+  }
+
+private:
+
+  // log(|det(M0)|)
+  double Log_Det0;
+
+  // Symmetric ordering, column k of the ordered matrix is column Q[k] of I - A, and Q_Inv is its inverse
+  std::vector<int> Q, Q_Inv;
+
+  // Row pivots, row k of the ordered matrix is row P_Inv[k] of L U
+  std::vector<int> P_Inv;
+
+  // L with unit diagonal first in every column, and U with the diagonal last in every column, in compressed columns
+  std::vector<int> Lp, Li, Up, Ui;
+  std::vector<double> Lx, Ux;
+
+  // Rows and columns of the updates, W column by column and K^(-1) in column major order
+  std::vector<int> Upd_Row, Upd_Col;
+  std::vector<double> W, K_Inv;
+
+  // Index of the kept column of (I - A)^(-1), -1 if there is none, and its entries
+  int Cached_Index;
+  std::vector<double> Cached;
+
+  // Order the responses by the strongly connected components of the graph with an edge i -> j for A(i, j) != 0,
+  // found by Tarjan's algorithm without recursion. Components are found in reverse topological order
+  void Order(const double* A) {
+
+    // Collect edges
+    std::vector<std::vector<int> > Out(p);
+
+    for (int j = 0; j < p; j++) {
+
+      for (int i = 0; i < p; i++) {
+
+        if (i != j && A[i + (size_t) j * p] != 0) {
+
+          Out[i].push_back(j);
+
+        }
+
+      }
+
+    }
+
+    std::vector<int> Index(p, -1), Low(p, 0), Next(p, 0), Stack, Call;
+    std::vector<char> On_Stack(p, 0);
+    int Counter = 0;
+
+    Q.clear();
+
+    for (int s = 0; s < p; s++) {
+
+      if (Index[s] >= 0) {
+
+        continue;
+
+      }
+
+      Call.push_back(s);
+
+      while (!Call.empty()) {
+
+        int v = Call.back();
+
+        // Visit v for the first time
+        if (Index[v] < 0) {
+
+          Index[v] = Low[v] = Counter++;
+          Stack.push_back(v);
+          On_Stack[v] = 1;
+
+        }
+
+        // Descend into the next unvisited successor
+        if (Next[v] < (int) Out[v].size()) {
+
+          int w = Out[v][Next[v]++];
+
+          if (Index[w] < 0) {
+
+            Call.push_back(w);
+
+          } else if (On_Stack[w]) {
+
+            Low[v] = std::min(Low[v], Index[w]);
+
+          }
+
+          continue;
+
+        }
+
+        // Pop a component whose root is v
+        if (Low[v] == Index[v]) {
+
+          int w;
+
+          do {
+
+            w = Stack.back();
+            Stack.pop_back();
+            On_Stack[w] = 0;
+            Q.push_back(w);
+
+          } while (w != v);
+
+        }
+
+        // Return to the caller
+        Call.pop_back();
+
+        if (!Call.empty()) {
+
+          Low[Call.back()] = std::min(Low[Call.back()], Low[v]);
+
+        }
+
+      }
+
+    }
+
+    // Reverse into topological order, so every edge goes from a component to the same or a later one
+    std::reverse(Q.begin(), Q.end());
+
+    Q_Inv.assign(p, 0);
+
+    for (int k = 0; k < p; k++) {
+
+      Q_Inv[Q[k]] = k;
+
+    }
+
+  }
+
+  // Factorize the ordered matrix C = (I - A)[Q, Q] as P C = L U
+  void Decompose(const double* A) {
+
+    const double Tol = 0.1;
+
+    Lp.assign(1, 0);
+    Up.assign(1, 0);
+    Li.clear();
+    Lx.clear();
+    Ui.clear();
+    Ux.clear();
+    P_Inv.assign(p, -1);
+    Log_Det0 = 0;
+
+    std::vector<double> x(p, 0);
+    std::vector<int> Pattern, Stack, Pos;
+    std::vector<char> Mark(p, 0);
+
+    for (int k = 0; k < p; k++) {
+
+      // Find the rows reachable from the entries of column k through the columns of L, in topological order
+      int q = Q[k];
+      std::vector<int> Vals_Rows;
+      std::vector<double> Vals;
+
+      for (int i = 0; i < p; i++) {
+
+        double v = (i == q) - A[i + (size_t) q * p];
+
+        if (v != 0) {
+
+          Vals_Rows.push_back(Q_Inv[i]);
+          Vals.push_back(v);
+
+        }
+
+      }
+
+      Pattern.clear();
+
+      for (size_t e = 0; e < Vals_Rows.size(); e++) {
+
+        if (!Mark[Vals_Rows[e]]) {
+
+          Reach(Vals_Rows[e], Mark, Pattern, Stack, Pos);
+
+        }
+
+      }
+
+      // Pattern holds the rows in reverse topological order
+      std::reverse(Pattern.begin(), Pattern.end());
+
+      for (size_t e = 0; e < Pattern.size(); e++) {
+
+        Mark[Pattern[e]] = 0;
+        x[Pattern[e]] = 0;
+
+      }
+
+      // Solve L x = C[, k]
+      for (size_t e = 0; e < Vals_Rows.size(); e++) {
+
+        x[Vals_Rows[e]] = Vals[e];
+
+      }
+
+      for (size_t e = 0; e < Pattern.size(); e++) {
+
+        int i = Pattern[e];
+        int J = P_Inv[i];
+
+        if (J < 0) {
+
+          continue;
+
+        }
+
+        for (int l = Lp[J] + 1; l < Lp[J + 1]; l++) {
+
+          x[Li[l]] -= Lx[l] * x[i];
+
+        }
+
+      }
+
+      // Store U and choose the pivot among the rows that are not pivotal yet
+      int Pivot = -1;
+      double Largest = -1;
+
+      for (size_t e = 0; e < Pattern.size(); e++) {
+
+        int i = Pattern[e];
+
+        if (P_Inv[i] < 0) {
+
+          if (std::abs(x[i]) > Largest) {
+
+            Largest = std::abs(x[i]);
+            Pivot = i;
+
+          }
+
+        } else {
+
+          Ui.push_back(P_Inv[i]);
+          Ux.push_back(x[i]);
+
+        }
+
+      }
+
+      // Prefer the diagonal, x is 0 at the rows outside the pattern
+      if (P_Inv[k] < 0 && x[k] != 0 && std::abs(x[k]) >= Tol * Largest) {
+
+        Pivot = k;
+
+      }
+
+      // A structurally singular column takes any row that is not pivotal yet with a zero pivot
+      double Pivot_Value = 0;
+
+      if (Pivot < 0) {
+
+        for (int i = 0; i < p && Pivot < 0; i++) {
+
+          if (P_Inv[i] < 0) {
+
+            Pivot = i;
+
+          }
+
+        }
+
+      } else {
+
+        Pivot_Value = x[Pivot];
+
+      }
+
+      Ui.push_back(k);
+      Ux.push_back(Pivot_Value);
+      Up.push_back(Ui.size());
+
+      P_Inv[Pivot] = k;
+      Log_Det0 += std::log(std::abs(Pivot_Value));
+
+      // Store L with the pivot row first
+      Li.push_back(Pivot);
+      Lx.push_back(1);
+
+      for (size_t e = 0; e < Pattern.size(); e++) {
+
+        int i = Pattern[e];
+
+        if (P_Inv[i] < 0) {
+
+          Li.push_back(i);
+          Lx.push_back(x[i] / Pivot_Value);
+
+        }
+
+        x[i] = 0;
+
+      }
+
+      Lp.push_back(Li.size());
+
+    }
+
+    // Number the rows of L by their pivots
+    for (size_t l = 0; l < Li.size(); l++) {
+
+      Li[l] = P_Inv[Li[l]];
+
+    }
+
+  }
+
+  // Add the rows reachable from row s through the columns of L to Pattern in reverse topological order
+  // A row i is followed to the rows of the column of L it is the pivot of, if it is pivotal yet
+  void Reach(int s, std::vector<char>& Mark, std::vector<int>& Pattern, std::vector<int>& Stack, std::vector<int>& Pos) {
+
+    Stack.assign(1, s);
+    Pos.assign(1, -1);
+
+    while (!Stack.empty()) {
+
+      int i = Stack.back();
+      int J = P_Inv[i];
+
+      // Start the row
+      if (Pos.back() < 0) {
+
+        Mark[i] = 1;
+        Pos.back() = (J < 0) ? 0 : Lp[J] + 1;
+
+      }
+
+      // Descend into the next unmarked row
+      int End = (J < 0) ? 0 : Lp[J + 1];
+      bool Done = true;
+
+      while (Pos.back() < End) {
+
+        int l = Li[Pos.back()++];
+
+        if (!Mark[l]) {
+
+          Stack.push_back(l);
+          Pos.push_back(-1);
+          Done = false;
+          break;
+
+        }
+
+      }
+
+      // Finish the row
+      if (Done) {
+
+        Pattern.push_back(i);
+        Stack.pop_back();
+        Pos.pop_back();
+
+      }
+
+    }
+
+  }
+
+  // Solve M0 x = e_i with the factorization
+  void Solve(int i, std::vector<double>& x) const {
+
+    std::vector<double> z(p, 0);
+
+    z[P_Inv[Q_Inv[i]]] = 1;
+
+    // Solve L y = P e
+    for (int k = 0; k < p; k++) {
+
+      if (z[k] != 0) {
+
+        for (int l = Lp[k] + 1; l < Lp[k + 1]; l++) {
+
+          z[Li[l]] -= Lx[l] * z[k];
+
+        }
+
+      }
+
+    }
+
+    // Solve U z = y
+    for (int k = p - 1; k >= 0; k--) {
+
+      if (z[k] != 0) {
+
+        z[k] /= Ux[Up[k + 1] - 1];
+
+        for (int l = Up[k]; l < Up[k + 1] - 1; l++) {
+
+          z[Ui[l]] -= Ux[l] * z[k];
+
+        }
+
+      }
+
+    }
+
+    // Undo the ordering
+    x.assign(p, 0);
+
+    for (int k = 0; k < p; k++) {
+
+      x[Q[k]] = z[k];
+
+    }
+
+  }
+
+};
+
+
+#endif